@@ -0,0 +1,2003 @@
+#ifndef BASICXMLPARSER_H
+#define BASICXMLPARSER_H
+
+//==============================================================================
+//
+//                 BasicXMLParser - the xml parser template class
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//==============================================================================
+
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
+
+#include "XMLInput.h"
+#include "XMLNumber.h"
+
+///
+/// @class XMLAttributeList
+///
+/// @brief The flat list of attributes of an element, with inline storage for
+///        the first N attributes. A cleared list reuses its slots. The list
+///        can also be assigned the raw text of a tag: the attributes are then
+///        only decoded on the first access.
+///
+template <typename T, std::size_t N = 4>
+class XMLAttributeList
+{
+public:
+  typedef std::pair<T, T>   value_type;
+  typedef const value_type *const_iterator;
+
+  XMLAttributeList() : _size(0), _pending(false) {}
+
+  ///
+  /// Find an attribute
+  ///
+  /// @param key      the attribute key
+  ///
+  /// @return the attribute or end()
+  ///
+  const_iterator find(std::string_view key) const
+  {
+    for (const_iterator iter = begin(); iter != end(); ++iter)
+    {
+      if (iter->first == key) return iter;
+    }
+
+    return end();
+  }
+
+  ///
+  /// Get the value of an attribute as number (see XMLNumber)
+  ///
+  /// @param key      the attribute key
+  /// @param value    the number (only set on success)
+  ///
+  /// @return success (false if the attribute is missing or not a number)
+  ///
+  bool getDouble(std::string_view key, double &value) const
+  {
+    const_iterator iter = find(key);
+
+    return iter != end() && XMLNumber::toDouble(iter->second, value);
+  }
+
+  ///
+  /// Insert an attribute; an existing key is not replaced (like std::map)
+  ///
+  /// @param key      the attribute key
+  /// @param value    the attribute value
+  ///
+  void insert(std::string_view key, std::string_view value)
+  {
+    decode();
+
+    add(key, value);
+  }
+
+  ///
+  /// Insert an attribute; an existing key is not replaced (like std::map)
+  ///
+  /// @param attribute  the key and value of the attribute
+  ///
+  void insert(const value_type &attribute)
+  {
+    insert(attribute.first, attribute.second);
+  }
+
+  ///
+  /// Assign the raw text of the attributes in a tag, i.e. after the name;
+  /// the text must stay valid till the list is used
+  ///
+  /// @param text     the text (example: ' lat="1.0" lon="2.0"')
+  ///
+  void assign(std::string_view text)
+  {
+    _size    = 0;
+    _raw     = text;
+    _pending = true;
+  }
+
+  ///
+  /// Get the raw text of the attributes, if assigned
+  ///
+  /// @return the text (nullptr if not assigned)
+  ///
+  std::string_view raw() const { return _raw; }
+
+  void clear() { _size = 0; _raw = std::string_view(); _pending = false; }
+
+  bool empty() const { decode(); return _size == 0; }
+
+  std::size_t size() const { decode(); return _size; }
+
+  const_iterator begin() const { decode(); return _heap.empty() ? _inline : _heap.data(); }
+  const_iterator end()   const { return begin() + _size; }
+
+private:
+  // Decode the raw text of the attributes, if not done yet
+  void decode() const
+  {
+    if (!_pending) return;
+
+    _pending = false;
+
+    std::string_view text = _raw;
+
+    auto isSpace = [](char ch) { return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n'; };
+
+    std::size_t i = 0;
+
+    while (true)
+    {
+      while (i < text.size() && isSpace(text[i])) i++;
+
+      std::size_t start = i;
+
+      while (i < text.size() && !isSpace(text[i]) && text[i] != '=') i++;
+
+      if (i == start) break;
+
+      std::string_view key = text.substr(start, i - start);
+
+      while (i < text.size() && isSpace(text[i])) i++;
+
+      if (i >= text.size() || text[i] != '=') break;
+
+      i++;
+
+      while (i < text.size() && isSpace(text[i])) i++;
+
+      if (i >= text.size() || (text[i] != '"' && text[i] != '\'')) break;
+
+      std::size_t end = text.find(text[i], i + 1);
+
+      if (end == std::string_view::npos) break;
+
+      add(key, text.substr(i + 1, end - i - 1));
+
+      i = end + 1;
+    }
+  }
+
+  // Add an attribute to the decoded ones
+  void add(std::string_view key, std::string_view value) const
+  {
+    for (std::size_t i = 0; i < _size; i++)
+    {
+      if (slot(i).first == key) return;
+    }
+
+    value_type &attribute = next();
+
+    attribute.first  = key;
+    attribute.second = value;
+  }
+
+  value_type &slot(std::size_t i) const { return _heap.empty() ? _inline[i] : _heap[i]; }
+
+  // The next free slot, moving to the heap if the inline slots are used
+  value_type &next() const
+  {
+    if (_heap.empty())
+    {
+      if (_size < N) return _inline[_size++];
+
+      _heap.assign(_inline, _inline + N);
+    }
+
+    if (_size == _heap.size()) _heap.emplace_back();
+
+    return _heap[_size++];
+  }
+
+  // The attributes are decoded on the first access, also of a const list
+  mutable value_type              _inline[N];
+  mutable std::vector<value_type> _heap;
+  mutable std::size_t             _size;
+  std::string_view                _raw;
+  mutable bool                    _pending;
+};
+
+///
+/// @class XMLPoint
+///
+/// @brief A simple point element (example: trkpt) passed as one event: the
+///        start tag with only the lat and lon attributes, the optional ele
+///        and time elements with only text, and the end tag. The views of
+///        the missing elements are empty.
+///
+struct XMLPoint
+{
+  std::string_view _name;
+  std::string_view _lat;
+  std::string_view _lon;
+  std::string_view _ele;
+  std::string_view _time;
+};
+
+///
+/// @class XMLPointBatch
+///
+/// @brief A batch of consecutive point elements with the same name, in
+///        arrays: the coordinates and the elevation as numbers, the time and
+///        the byte span of the elements in the document. A missing or invalid
+///        number is std::numeric_limits<double>::min(), a missing time is empty.
+///
+struct XMLPointBatch
+{
+  std::string_view              _name;
+  std::vector<double>           _lat;
+  std::vector<double>           _lon;
+  std::vector<double>           _ele;
+  std::vector<std::string_view> _time;
+  std::vector<std::uint64_t>    _offset;
+  std::vector<std::uint64_t>    _length;
+
+  std::size_t size() const { return _lat.size(); }
+
+  bool empty() const { return _lat.empty(); }
+
+  ///
+  /// Add a point; the name of the batch is the name of the first point
+  ///
+  /// @param text      the text of the point element
+  /// @param point     the point
+  /// @param offset    the byte offset of the element in the document
+  ///
+  void add(std::string_view text, const XMLPoint &point, std::uint64_t offset)
+  {
+    if (empty()) _name = point._name;
+
+    _lat.push_back(toDouble(point._lat));
+    _lon.push_back(toDouble(point._lon));
+    _ele.push_back(toDouble(point._ele));
+    _time.push_back(point._time);
+    _offset.push_back(offset);
+    _length.push_back(text.size());
+  }
+
+  ///
+  /// Clear the batch; the arrays keep their capacity
+  ///
+  void clear()
+  {
+    _name = std::string_view();
+    _lat.clear();
+    _lon.clear();
+    _ele.clear();
+    _time.clear();
+    _offset.clear();
+    _length.clear();
+  }
+
+  ///
+  /// Convert a number (see XMLNumber)
+  ///
+  /// @param value     the text of the number
+  ///
+  /// @return the number or std::numeric_limits<double>::min()
+  ///
+  static double toDouble(std::string_view value)
+  {
+    double result;
+
+    return XMLNumber::toDouble(value, result) ? result : std::numeric_limits<double>::min();
+  }
+};
+
+///
+/// @class BasicXMLParserHandler
+///
+/// @brief The base class for a handler of the BasicXMLParser. The callbacks
+///        are not virtual and do nothing: a handler defines only the callbacks
+///        it needs, the others are not called by the parser. The views are
+///        only valid during the callback.
+///
+class BasicXMLParserHandler
+{
+public:
+  typedef XMLAttributeList<std::string_view> Attributes;
+
+  void xmlDecl(std::string_view, const Attributes &) {}
+  void processingInstruction(std::string_view, std::string_view, std::string_view) {}
+  void docTypeDecl(std::string_view) {}
+  void comment(std::string_view, std::string_view) {}
+  void startElement(std::string_view, std::string_view, const Attributes &) {}
+  void endElement(std::string_view, std::string_view) {}
+  void startEndElement(std::string_view, std::string_view, const Attributes &) {}
+  void text(std::string_view) {}
+  void cdataDecl(std::string_view, std::string_view) {}
+  void unhandled(std::string_view, int, int) {}
+  void skipped(std::string_view) {}
+  void point(std::string_view, const XMLPoint &) {}
+  void pointBatch(const XMLPointBatch &) {}
+};
+
+///
+/// @class XMLParserCallbacks
+///
+/// @brief The callbacks defined by a handler, i.e. not the empty ones of
+///        BasicXMLParserHandler. A handler with virtual callbacks defines all.
+///
+template <typename Handler>
+struct XMLParserCallbacks
+{
+  typedef BasicXMLParserHandler Empty;
+
+  static constexpr bool xmlDecl               = !std::is_same<decltype(&Handler::xmlDecl),               decltype(&Empty::xmlDecl)>::value;
+  static constexpr bool processingInstruction = !std::is_same<decltype(&Handler::processingInstruction), decltype(&Empty::processingInstruction)>::value;
+  static constexpr bool docTypeDecl           = !std::is_same<decltype(&Handler::docTypeDecl),           decltype(&Empty::docTypeDecl)>::value;
+  static constexpr bool comment               = !std::is_same<decltype(&Handler::comment),               decltype(&Empty::comment)>::value;
+  static constexpr bool startElement          = !std::is_same<decltype(&Handler::startElement),          decltype(&Empty::startElement)>::value;
+  static constexpr bool endElement            = !std::is_same<decltype(&Handler::endElement),            decltype(&Empty::endElement)>::value;
+  static constexpr bool startEndElement       = !std::is_same<decltype(&Handler::startEndElement),       decltype(&Empty::startEndElement)>::value;
+  static constexpr bool text                  = !std::is_same<decltype(&Handler::text),                  decltype(&Empty::text)>::value;
+  static constexpr bool cdataDecl             = !std::is_same<decltype(&Handler::cdataDecl),             decltype(&Empty::cdataDecl)>::value;
+  static constexpr bool unhandled             = !std::is_same<decltype(&Handler::unhandled),             decltype(&Empty::unhandled)>::value;
+  static constexpr bool skipped               = !std::is_same<decltype(&Handler::skipped),               decltype(&Empty::skipped)>::value;
+  static constexpr bool point                 = !std::is_same<decltype(&Handler::point),                 decltype(&Empty::point)>::value;
+  static constexpr bool pointBatch            = !std::is_same<decltype(&Handler::pointBatch),            decltype(&Empty::pointBatch)>::value;
+};
+
+///
+/// @class XMLParserFilter
+///
+/// @brief The events and elements a handler is interested in. The parser does
+///        not call the other events and does not build their arguments.
+///
+class XMLParserFilter
+{
+public:
+  ///
+  /// The events
+  ///
+  enum Event
+  {
+    XML_DECL               = 0x001,
+    PROCESSING_INSTRUCTION = 0x002,
+    DOCTYPE_DECL           = 0x004,
+    COMMENT                = 0x008,
+    START_ELEMENT          = 0x010,
+    END_ELEMENT            = 0x020,
+    START_END_ELEMENT      = 0x040,
+    TEXT                   = 0x080,
+    CDATA_DECL             = 0x100,
+    UNHANDLED              = 0x200,
+    SKIPPED                = 0x400,
+    POINT                  = 0x800,
+    ALL_EVENTS             = 0xfff
+  };
+
+  ///
+  /// Constructor: all events, attributes and text
+  ///
+  XMLParserFilter() :
+    _events(ALL_EVENTS),
+    _allAttributes(true),
+    _allText(true),
+    _skipWhitespace(false),
+    _pointBatchSize(0)
+  {
+  }
+
+  ///
+  /// Set the events to be called
+  ///
+  /// @param events    the events (or'ed)
+  ///
+  void setEvents(unsigned events) { _events = events; }
+
+  ///
+  /// Get the events to be called
+  ///
+  /// @return the events (or'ed)
+  ///
+  unsigned events() const { return _events; }
+
+  ///
+  /// Is the event called ?
+  ///
+  /// @param event     the event
+  ///
+  /// @return is it ?
+  ///
+  bool hasEvent(Event event) const { return (_events & event) != 0; }
+
+  ///
+  /// Build the attributes only for the elements; the others get none
+  ///
+  /// @param names     the names of the elements
+  ///
+  void setAttributesFor(std::initializer_list<std::string_view> names)
+  {
+    _allAttributes = false;
+    _attributesFor.assign(names.begin(), names.end());
+  }
+
+  ///
+  /// Are the attributes of an element built ?
+  ///
+  /// @param name      the name of the element
+  ///
+  /// @return are they ?
+  ///
+  bool hasAttributes(std::string_view name) const { return _allAttributes || contains(_attributesFor, name); }
+
+  ///
+  /// Call the text only directly in the elements, i.e. between the start tag
+  /// and the next start or end tag
+  ///
+  /// @param names     the names of the elements
+  ///
+  void setTextFor(std::initializer_list<std::string_view> names)
+  {
+    _allText = false;
+    _textFor.assign(names.begin(), names.end());
+  }
+
+  ///
+  /// Is the text in an element called ?
+  ///
+  /// @param name      the name of the element
+  ///
+  /// @return is it ?
+  ///
+  bool hasText(std::string_view name) const { return _allText || contains(_textFor, name); }
+
+  ///
+  /// Is all text called ?
+  ///
+  /// @return is it ?
+  ///
+  bool hasAllText() const { return _allText; }
+
+  ///
+  /// Skip the text with only whitespace
+  ///
+  /// @param skip      skip the whitespace ?
+  ///
+  void setSkipWhitespace(bool skip) { _skipWhitespace = skip; }
+
+  ///
+  /// Is the text with only whitespace skipped ?
+  ///
+  /// @return is it ?
+  ///
+  bool skipWhitespace() const { return _skipWhitespace; }
+
+  ///
+  /// Skip the elements with their contents; they are passed as one raw
+  /// text to the skipped event. The contents are not checked.
+  ///
+  /// @param names     the names of the elements
+  ///
+  void setSkipFor(std::initializer_list<std::string_view> names) { _skipFor.assign(names.begin(), names.end()); }
+
+  ///
+  /// Is the element skipped ?
+  ///
+  /// @param name      the name of the element
+  ///
+  /// @return is it ?
+  ///
+  bool skips(std::string_view name) const { return !_skipFor.empty() && contains(_skipFor, name); }
+
+  ///
+  /// Pass the simple elements as one point event (see XMLPoint), without the
+  /// events of their contents; the other elements with the names are passed
+  /// as usual. The element must be complete in the parsed data.
+  ///
+  /// @param names     the names of the elements
+  ///
+  void setPointsFor(std::initializer_list<std::string_view> names) { _pointsFor.assign(names.begin(), names.end()); }
+
+  ///
+  /// Are there elements passed as point ?
+  ///
+  /// @return are there ?
+  ///
+  bool hasPoints() const { return !_pointsFor.empty(); }
+
+  ///
+  /// Is the element passed as point, if simple ?
+  ///
+  /// @param name      the name of the element
+  ///
+  /// @return is it ?
+  ///
+  bool isPoint(std::string_view name) const { return !_pointsFor.empty() && contains(_pointsFor, name); }
+
+  ///
+  /// Pass the points in batches to the pointBatch event instead of one by one
+  /// to the point event (see XMLPointBatch). A batch is passed when it is
+  /// full and before any other event.
+  ///
+  /// @param size      the maximum number of points in a batch (0: no batches)
+  ///
+  void setPointBatchSize(std::size_t size) { _pointBatchSize = size; }
+
+  ///
+  /// Get the maximum number of points in a batch
+  ///
+  /// @return the number of points (0: no batches)
+  ///
+  std::size_t pointBatchSize() const { return _pointBatchSize; }
+
+private:
+  static bool contains(const std::vector<std::string> &names, std::string_view name)
+  {
+    for (auto iter = names.begin(); iter != names.end(); ++iter)
+    {
+      if (*iter == name) return true;
+    }
+
+    return false;
+  }
+
+  // Members
+  unsigned                 _events;
+  bool                     _allAttributes;
+  std::vector<std::string> _attributesFor;
+  bool                     _allText;
+  std::vector<std::string> _textFor;
+  bool                     _skipWhitespace;
+  std::vector<std::string> _skipFor;
+  std::vector<std::string> _pointsFor;
+  std::size_t              _pointBatchSize;
+};
+
+///
+/// @class XMLCharClass
+///
+/// @brief A set of characters as a 256 entry table, so a character is
+///        tested with one lookup.
+///
+class XMLCharClass
+{
+public:
+  ///
+  /// Constructor
+  ///
+  /// @param chars     the characters in the set
+  ///
+  constexpr XMLCharClass(const char *chars) :
+    _table()
+  {
+    for (; *chars != '\0'; chars++) _table[static_cast<unsigned char>(*chars)] = true;
+  }
+
+  ///
+  /// Is the character in the set ?
+  ///
+  /// @param ch        the character
+  ///
+  /// @return is it ?
+  ///
+  constexpr bool contains(char ch) const { return _table[static_cast<unsigned char>(ch)]; }
+
+private:
+  bool _table[256];
+};
+
+///
+/// @class BasicXMLParser
+///
+/// @brief The xml parser class for a handler type. The callbacks are called
+///        on the handler type, so a handler with non virtual callbacks has
+///        them inlined. The parser calls the handler with views in its buffer.
+///
+template <typename Handler>
+class BasicXMLParser
+{
+public:
+  typedef XMLAttributeList<std::string_view> Attributes;
+
+  ///
+  /// Constructor
+  ///
+  /// @param handler     the handler
+  ///
+  BasicXMLParser(Handler *handler = nullptr);
+
+  ///
+  /// Deconstructor
+  ///
+  ~BasicXMLParser() {}
+
+  // Properties
+
+  ///
+  /// Set the handler
+  ///
+  /// @param handler     the handler
+  ///
+  void setHandler(Handler *handler) { _handler = handler; }
+
+  ///
+  /// Set the filter for the events
+  ///
+  /// @param filter      the filter
+  ///
+  void setFilter(const XMLParserFilter &filter) { _filter = filter; _inText = filter.hasAllText(); }
+
+  ///
+  /// Get the current line number; the position is not tracked while parsing,
+  /// but counted on request from the last known position
+  ///
+  /// @return the current line number
+  ///
+  int lineNumber() const { sync(_offset); return _lineNumber; }
+
+  ///
+  /// Get the current column number
+  ///
+  /// @return the current column number
+  ///
+  int columnNumber() const { sync(_offset); return _columnNumber; }
+
+  ///
+  /// Get the byte offset in the document of the current event, i.e. of the
+  /// start of its text
+  ///
+  /// @return the byte offset
+  ///
+  std::uint64_t offset() const { return _offset; }
+
+  ///
+  /// Is all markup parsed and is the parser in the same state as at the
+  /// start, i.e. can a new parser continue after the parsed data ?
+  ///
+  /// @return is it
+  ///
+  bool isComplete() const { return _state == TEXT && _inText == _filter.hasAllText(); }
+
+  // Parsing methods
+
+  ///
+  /// Parse data
+  ///
+  /// @param  data    the data to be parsed
+  /// @param  length  the length of the data
+  /// @param  isFinal is this the last data ?
+  ///
+  /// @return success
+  ///
+  bool parse(const char *data, size_t length, bool isFinal);
+
+  ///
+  /// Parse text
+  ///
+  /// @param  text    the zero terminated text to be parsed
+  /// @param  isFinal is this the last data ?
+  ///
+  /// @return success
+  ///
+  bool parse(const char *text, bool isFinal) { return parse(text, strlen(text), isFinal); }
+
+  ///
+  /// Parse string
+  ///
+  /// @param  data    the data to be parsed
+  /// @param  isFinal is this the last data ?
+  ///
+  /// @return success
+  ///
+  bool parse(const std::string &data, bool isFinal) { return parse(data.data(), data.size(), isFinal); }
+
+  ///
+  /// Parse an input stream
+  ///
+  /// @param  stream        the stream to be parsed
+  ///
+  /// @return success
+  ///
+  bool parse(std::istream &stream);
+
+  ///
+  /// Parse an input
+  ///
+  /// @param  input         the opened input
+  ///
+  /// @return success
+  ///
+  bool parse(XMLInput &input);
+
+  ///
+  /// Parse a file; a regular file is memory mapped and parsed in place
+  ///
+  /// @param  filename      the name of the file
+  ///
+  /// @return success (also false if the file can not be opened)
+  ///
+  bool parseFile(const std::string &filename);
+
+  ///
+  /// Suspend the parsing after the current callback: parse() returns and the
+  /// views of the callback stay valid till resume(). Only for the callers of
+  /// parse(data, length, isFinal), that keep the data till it is parsed.
+  ///
+  void suspend() { _suspended = true; }
+
+  ///
+  /// Is the parsing suspended ?
+  ///
+  /// @return is it
+  ///
+  bool isSuspended() const { return _suspended; }
+
+  ///
+  /// Resume the suspended parsing of the data
+  ///
+  /// @return success
+  ///
+  bool resume() { return parseInput(); }
+
+private:
+  // Types
+  enum State
+  {
+    TEXT,
+    MARKUP,
+    COMMENT,
+    PI,
+    ELEMENT,
+    SKIP
+  };
+  void setState(State state);
+
+  enum Result
+  {
+    ERROR,
+    MORE,
+    OK,
+    FAIL
+  };
+
+  typedef std::string::size_type size_type;
+
+  typedef XMLParserCallbacks<Handler> Callbacks;
+
+  struct Span
+  {
+    size_type offset;
+    size_type length;
+  };
+
+  bool parseInput();
+
+  // Token: the current text or markup, in the input or in the carry-over buffer
+
+  const char *token() const { return _carried ? _out.data() : _in + _start; }
+
+  size_type tokenSize() const { return _carried ? _out.size() : _i - _start; }
+
+  std::string_view tokenView() const { return std::string_view(token(), tokenSize()); }
+
+  std::string_view tokenView(const Span &span) const { return std::string_view(token() + span.offset, span.length); }
+
+  void carryToken();
+
+  // String parsing
+
+  static void advance(const char *data, size_type length, int &lineNumber, int &columnNumber);
+
+  void sync(std::uint64_t offset) const;
+
+  bool pull();
+  bool pullAll();
+  bool pullUntil();
+
+  char hasChar(size_type j);
+
+  // The character classes of the lexer
+  static constexpr XMLCharClass WHITESPACE       { " \t\r\n" };
+  static constexpr XMLCharClass TARGET_END       { " \t\r\n?>" };
+  static constexpr XMLCharClass DECL_KEY_END     { " \t\r\n=?>" };
+  static constexpr XMLCharClass NAME_END         { " \t\r\n/>" };
+  static constexpr XMLCharClass KEY_END          { " \t\r\n=/>" };
+  static constexpr XMLCharClass DQUOTE_VALUE_END { "\">" };
+  static constexpr XMLCharClass SQUOTE_VALUE_END { "'>" };
+  static constexpr XMLCharClass SUBSET_START     { "[>" };
+  static constexpr XMLCharClass SUBSET_END       { "]" };
+  static constexpr XMLCharClass MARKUP_END       { ">" };
+
+  // XML Parsing
+  Result parseText();
+  Result parseMarkup();
+
+  Result parseDeclaration();
+  Result parseSection();
+  Result parseElement();
+  Result parseSkip();
+  Result parsePoint();
+  Result parseAttribute(const XMLCharClass &keyEnd, size_type &j, Span &key, Span &value);
+  Result doUnhandled();
+  void   doText();
+  void   doPoints();
+
+  bool wants(bool callback, XMLParserFilter::Event event) const { return callback && _filter.hasEvent(event) && _handler != nullptr; }
+
+  void setAttributes(const Span &name, const Span &attributes);
+
+  Result matchChar(char ch, size_type &j);
+  Result matchChar(const XMLCharClass &chars, size_type &j);
+  Result matchNotChar(const XMLCharClass &chars, size_type &j);
+  Result matchString(std::string_view pattern, size_type &j);
+  Result matchChars(const XMLCharClass &chars, size_type &j);
+  Result matchNotChars(const XMLCharClass &chars, size_type &j);
+  Result skipTillString(std::string_view pattern, size_type &j, Span &text);
+  Result skipTillNotChar(const XMLCharClass &chars, size_type &j, Span &text);
+  Result skipTillChar(const XMLCharClass &chars, size_type &j, Span &text);
+
+  // Members
+  Handler              *_handler;
+  XMLParserFilter       _filter;
+  bool                  _inText;
+
+  State                 _state;
+
+  const char           *_in;
+  std::uint64_t         _inOffset;
+  size_type             _inSize;
+  size_type             _i;
+  bool                  _isFinal;
+  bool                  _suspended;
+
+  size_type             _start;
+  bool                  _carried;
+  std::string           _out;
+  size_type             _peek;
+
+  // Unfinished markup, continued with the next input: the pattern the markup
+  // waits for, or the next attribute of a start tag
+  std::string           _until;
+  size_type             _scan;
+  size_type             _elementNext;
+  Span                  _elementName;
+
+  Attributes            _attributes;
+  XMLPointBatch         _batch;
+
+  size_type             _skipLength;
+  int                   _skipDepth;
+
+  std::uint64_t         _offset;
+  mutable std::uint64_t _lineOffset;
+  mutable int           _lineNumber;
+  mutable int           _columnNumber;
+
+  // Disable copy constructors
+  BasicXMLParser(const BasicXMLParser &);
+  BasicXMLParser& operator=(const BasicXMLParser &);
+};
+
+// -- Implementation ----------------------------------------------------------
+
+template <typename Handler>
+BasicXMLParser<Handler>::BasicXMLParser(Handler *handler) :
+  _handler(handler),
+  _inText(true),
+  _state(TEXT),
+  _in(nullptr),
+  _inOffset(0),
+  _inSize(0),
+  _i(0),
+  _isFinal(false),
+  _suspended(false),
+  _start(0),
+  _carried(false),
+  _peek(0),
+  _scan(0),
+  _elementNext(0),
+  _elementName(),
+  _skipLength(0),
+  _skipDepth(0),
+  _offset(0),
+  _lineOffset(0),
+  _lineNumber(1),
+  _columnNumber(1)
+{
+}
+
+template <typename Handler>
+bool BasicXMLParser<Handler>::parse(const char *data, size_t length, bool isFinal)
+{
+  _in       = data;
+  _inOffset = _offset + (_carried ? _out.size() : 0);
+  _inSize   = length;
+  _i        = 0;
+  _isFinal  = isFinal;
+
+  if (!_carried) _start = 0;
+
+  return parseInput();
+}
+
+// Parse the (rest of the) input till its end or till a callback suspends
+template <typename Handler>
+bool BasicXMLParser<Handler>::parseInput()
+{
+  Result result = OK;
+
+  _suspended = false;
+
+  while (_i < _inSize && result == OK && !_suspended)
+  {
+    switch(_state)
+    {
+      case TEXT:   result = parseText();   break;
+      case MARKUP: result = parseMarkup(); break;
+      case SKIP:   result = parseSkip();   break;
+    }
+  }
+
+  // The points are views in the input
+  doPoints();
+
+  if (_suspended) return true;
+
+  if (_isFinal)
+  {
+    if (_state == TEXT && result != FAIL)
+    {
+      if (tokenSize() > 0) doText();
+    }
+
+    if (_state == MARKUP)
+    {
+      if (wants(Callbacks::unhandled, XMLParserFilter::UNHANDLED) && tokenSize() > 0)
+      {
+        sync(_offset);
+
+        int lineNumber   = _lineNumber;
+        int columnNumber = _columnNumber;
+
+        advance(token(), tokenSize(), lineNumber, columnNumber);
+
+        _handler->unhandled(tokenView(), lineNumber, columnNumber);
+      }
+    }
+
+    if (_state == SKIP)
+    {
+      if (wants(Callbacks::skipped, XMLParserFilter::SKIPPED) && tokenSize() > 0) _handler->skipped(tokenView());
+    }
+
+    // The rest is processed, also if resumed after a suspend
+    sync(_offset + tokenSize());
+
+    _offset += tokenSize();
+
+    _start   = _i;
+    _carried = false;
+    _out.clear();
+  }
+
+  // The position is kept up to date with the input that is released
+  sync(_offset);
+
+  carryToken();
+
+  return (result == OK || result == MORE);
+}
+
+template <typename Handler>
+bool BasicXMLParser<Handler>::parse(std::istream &stream)
+{
+  if (!stream.good()) return false;
+
+  char buffer[4096];
+
+  while (stream.good())
+  {
+    stream.read(buffer, sizeof(buffer));
+
+    if (!parse(buffer, stream.gcount(), (stream.gcount() < sizeof(buffer)))) return false;
+  }
+
+  return true;
+}
+
+template <typename Handler>
+bool BasicXMLParser<Handler>::parse(XMLInput &input)
+{
+  if (!input.isOpen()) return false;
+
+  const char *data;
+  size_t      length;
+
+  while (input.read(data, length))
+  {
+    if (!parse(data, length, false)) return false;
+  }
+
+  if (!parse("", 0, true)) return false;
+
+  return input.isEof();
+}
+
+template <typename Handler>
+bool BasicXMLParser<Handler>::parseFile(const std::string &filename)
+{
+  XMLInput input;
+
+  if (!input.open(filename)) return false;
+
+  return parse(input);
+}
+
+// Set the state; the markup ends after the examined characters
+template <typename Handler>
+void BasicXMLParser<Handler>::setState(State state)
+{
+  if (_carried) sync(_offset + _peek);
+
+  _offset += _peek;
+
+  if (_carried)
+  {
+    _i -= (_out.size() - _peek);
+  }
+  else
+  {
+    _i = _start + _peek;
+  }
+
+  _state   = state;
+
+  _start   = _i;
+  _carried = false;
+  _out.clear();
+  _peek    = 0;
+
+  _until.clear();
+  _elementNext = 0;
+}
+
+// Keep the unfinished token for the next data
+template <typename Handler>
+void BasicXMLParser<Handler>::carryToken()
+{
+  if (!_carried && tokenSize() > 0)
+  {
+    _out.assign(token(), tokenSize());
+
+    _carried = true;
+  }
+}
+
+// Update the line and column number for the processed characters
+template <typename Handler>
+void BasicXMLParser<Handler>::advance(const char *data, size_type length, int &lineNumber, int &columnNumber)
+{
+  int lines = std::count(data, data + length, '\n');
+
+  if (lines > 0)
+  {
+    size_type last = std::string_view(data, length).rfind('\n');
+
+    lineNumber  += lines;
+    columnNumber = 1 + (length - last - 1);
+  }
+  else
+  {
+    columnNumber += length;
+  }
+}
+
+// Update the line and column number till the offset in the document; the
+// characters since the last update are in the input or in the carried token
+template <typename Handler>
+void BasicXMLParser<Handler>::sync(std::uint64_t offset) const
+{
+  if (_lineOffset < offset && _carried && _lineOffset < _inOffset)
+  {
+    std::uint64_t end = std::min(offset, _inOffset);
+
+    advance(_out.data() + (_lineOffset - _offset), end - _lineOffset, _lineNumber, _columnNumber);
+
+    _lineOffset = end;
+  }
+
+  if (_lineOffset < offset)
+  {
+    advance(_in + (_lineOffset - _inOffset), offset - _lineOffset, _lineNumber, _columnNumber);
+
+    _lineOffset = offset;
+  }
+}
+
+// XML Parsing
+
+// Extend the markup in bulk till the next '>' in the input
+template <typename Handler>
+bool BasicXMLParser<Handler>::pull()
+{
+  if (_i == _inSize) return false;
+
+  const char *p = static_cast<const char *>(memchr(_in + _i, '>', _inSize - _i));
+
+  size_type end = (p != nullptr ? p - _in + 1 : _inSize);
+
+  if (_carried) _out.append(_in + _i, end - _i);
+
+  _i = end;
+
+  return true;
+}
+
+// Extend the markup with all of the input
+template <typename Handler>
+bool BasicXMLParser<Handler>::pullAll()
+{
+  if (_i == _inSize) return false;
+
+  if (_carried) _out.append(_in + _i, _inSize - _i);
+
+  _i = _inSize;
+
+  return true;
+}
+
+// Extend the markup till the pattern it waits for is in the token, scanning
+// only the new characters; false if the input ends before
+template <typename Handler>
+bool BasicXMLParser<Handler>::pullUntil()
+{
+  while (true)
+  {
+    if (tokenView().find(_until, _scan) != std::string_view::npos)
+    {
+      _until.clear();
+
+      return true;
+    }
+
+    if (tokenSize() >= _until.size()) _scan = std::max(_scan, tokenSize() - _until.size() + 1);
+
+    if (!pull()) return false;
+  }
+}
+
+template <typename Handler>
+char BasicXMLParser<Handler>::hasChar(size_type j)
+{
+  if (j >= tokenSize() && !pull()) return '\0';
+
+  if (j >= _peek) _peek = j + 1;
+
+  return token()[j];
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::parseText()
+{
+  const char *p = static_cast<const char *>(memchr(_in + _i, '<', _inSize - _i));
+
+  if (p == nullptr)
+  {
+    if (_carried) _out.append(_in + _i, _inSize - _i);
+
+    _i = _inSize;
+
+    return MORE;
+  }
+
+  size_type end = p - _in;
+
+  if (_carried) _out.append(_in + _i, end - _i);
+
+  _i = end;
+
+  if (tokenSize() > 0)
+  {
+    doText();
+
+    if (_carried) sync(_offset + tokenSize());
+
+    _offset += tokenSize();
+  }
+
+  _state   = MARKUP;
+
+  _start   = _i++;
+  _carried = false;
+  _out.clear();
+  _peek    = 1;
+
+  _until.clear();
+  _elementNext = 0;
+
+  return OK;
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::parseMarkup()
+{
+  Result result = FAIL;
+
+  char ch;
+
+  if (!_until.empty() && !pullUntil()) return MORE;
+
+  if ((ch = hasChar(1)) == '\0') return MORE;
+
+  if (result == FAIL && ch != '?' && ch != '!' && ch != '/' && _filter.hasPoints() &&
+      wants(Callbacks::point || Callbacks::pointBatch, XMLParserFilter::POINT)) result = parsePoint();
+
+  if (result == FAIL) doPoints();
+
+  if (result == FAIL && ch == '?') result = parseDeclaration();
+
+  if (result == FAIL && ch == '!') result = parseSection();
+
+  if (result == FAIL) result = parseElement();
+
+  if (result == FAIL) result = doUnhandled();
+
+  return result;
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::doUnhandled()
+{
+  if (wants(Callbacks::unhandled, XMLParserFilter::UNHANDLED))
+  {
+    sync(_offset);
+
+    int lineNumber   = _lineNumber;
+    int columnNumber = _columnNumber;
+
+    advance(token(), _peek, lineNumber, columnNumber);
+
+    _handler->unhandled(std::string_view(token(), _peek), lineNumber, columnNumber);
+  }
+
+  setState(TEXT);
+
+  return OK;
+}
+
+// Call the text, if in an element with text
+template <typename Handler>
+void BasicXMLParser<Handler>::doText()
+{
+  if (!_inText || !wants(Callbacks::text, XMLParserFilter::TEXT)) return;
+
+  std::string_view text = tokenView();
+
+  if (_filter.skipWhitespace() && text.find_first_not_of(" \t\r\n") == std::string_view::npos) return;
+
+  doPoints();
+
+  _handler->text(text);
+}
+
+// Pass the batch of points, before the next event
+template <typename Handler>
+void BasicXMLParser<Handler>::doPoints()
+{
+  if (_batch.empty()) return;
+
+  _handler->pointBatch(_batch);
+
+  _batch.clear();
+}
+
+// Assign the raw attributes of a start tag, if the element has attributes
+template <typename Handler>
+void BasicXMLParser<Handler>::setAttributes(const Span &name, const Span &attributes)
+{
+  if (_filter.hasAttributes(tokenView(name)))
+  {
+    _attributes.assign(tokenView(attributes));
+  }
+  else
+  {
+    _attributes.clear();
+  }
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::parseDeclaration()
+{
+  size_type j = 1;
+
+  Result result;
+
+  Span target;
+
+  if ((result = matchChar('?', j)) != OK) return result;
+
+  if ((result = skipTillChar(TARGET_END, j, target)) != OK) return result;
+
+  if (tokenView(target) == "xml") // XMLDecl
+  {
+    if ((result = matchChars(WHITESPACE, j)) == MORE) return result;
+
+    while (true)
+    {
+      Span key;
+      Span value;
+
+      if ((result = parseAttribute(DECL_KEY_END, j, key, value)) != OK) return result;
+
+      if (key.length == 0) break;
+    }
+
+    Span attributes = { target.offset + target.length, j - target.offset - target.length };
+
+    if ((result = matchString("?>", j)) != OK) return result;
+
+    if (wants(Callbacks::xmlDecl, XMLParserFilter::XML_DECL))
+    {
+      _attributes.assign(tokenView(attributes));
+
+      _handler->xmlDecl(tokenView(), _attributes);
+    }
+  }
+  else // Processing instruction
+  {
+    Span value;
+
+    if (target.length == 0) return FAIL;
+
+    if ((result = matchChars(WHITESPACE, j)) == MORE) return result;
+
+    if ((result = skipTillString("?>", j, value)) != OK) return result;
+
+    if (wants(Callbacks::processingInstruction, XMLParserFilter::PROCESSING_INSTRUCTION)) _handler->processingInstruction(tokenView(), tokenView(target), tokenView(value));
+  }
+
+  setState(TEXT);
+
+  return OK;
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::parseSection()
+{
+  size_type j = 1;
+
+  Result result;
+
+  if ((result = matchChar('!', j)) != OK) return result;
+
+  if ((result = matchString("--", j)) == MORE) return result;
+
+  if (result == OK) // Comment
+  {
+    Span text;
+
+    if ((result = skipTillString("-->", j, text)) != OK) return result;
+
+    if (wants(Callbacks::comment, XMLParserFilter::COMMENT)) _handler->comment(tokenView(), tokenView(text));
+
+    setState(TEXT);
+
+    return OK;
+  }
+
+  if ((result = matchString("[CDATA[", j)) == MORE) return result;
+
+  if (result == OK)
+  {
+    Span text;
+
+    if ((result = skipTillString("]]>", j, text)) != OK) return result;
+
+    if (wants(Callbacks::cdataDecl, XMLParserFilter::CDATA_DECL)) _handler->cdataDecl(tokenView(), tokenView(text));
+  }
+  else
+  {
+    if ((result = matchString("DOCTYPE", j)) != OK) return result;
+
+    if ((result = matchChar(WHITESPACE, j)) != OK) return result;
+
+    Span dummy;
+
+    if ((result = skipTillChar(SUBSET_START, j, dummy)) != OK) return result;
+
+    if ((result = matchChar('[', j)) == MORE) return result;
+
+    if (result == OK)
+    {
+      if ((result = skipTillChar(SUBSET_END, j, dummy)) != OK) return result;
+
+      if ((result = matchChar(']', j)) != OK) return result;
+    }
+
+    if ((result = skipTillChar(MARKUP_END, j, dummy)) != OK) return result;
+
+    if ((result = matchChar('>', j)) != OK) return result;
+
+    if (wants(Callbacks::docTypeDecl, XMLParserFilter::DOCTYPE_DECL)) _handler->docTypeDecl(tokenView());
+  }
+  setState(TEXT);
+
+  return OK;
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::parseAttribute(const XMLCharClass &keyEnd, size_type &j, Span &key, Span &value)
+{
+  Result result;
+
+  if ((result = skipTillChar(keyEnd, j, key)) != OK) return result;
+
+  if (key.length == 0) return OK;
+
+  if ((result = matchChars(WHITESPACE, j)) == MORE) return result;
+
+  if ((result = matchChar('=', j)) != OK) return result;
+
+  if ((result = matchChars(WHITESPACE, j)) == MORE) return result;
+
+  if ((result = matchChar('"', j)) == MORE) return result;
+
+  if (result == OK)
+  {
+    if ((result = skipTillChar(DQUOTE_VALUE_END, j, value)) != OK) return result;
+
+    if ((result = matchChar('>', j)) == OK) return FAIL;
+
+    if ((result = matchChar('"', j)) != OK) return result;
+  }
+  else
+  {
+    if ((result = matchChar('\'', j)) != OK) return result;
+
+    if ((result = skipTillChar(SQUOTE_VALUE_END, j, value)) != OK) return result;
+
+    if ((result = matchChar('>', j)) == OK) return FAIL;
+
+    if ((result = matchChar('\'', j)) != OK) return result;
+  }
+
+  if ((result = matchChars(WHITESPACE, j)) == MORE) return result;
+
+  return OK;
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::parseElement()
+{
+  size_type j = 1;
+
+  bool startTag = false;
+  bool endTag   = false;
+
+  Result result;
+
+  Span name;
+
+  if (_elementNext > 0) // Continue the start tag with the next attribute
+  {
+    startTag = true;
+    name     = _elementName;
+    j        = _elementNext;
+  }
+  else
+  {
+    if ((result = matchChar('/', j)) == MORE) return result;
+
+    if (result == OK) endTag = true; else startTag = true;
+
+    if ((result = skipTillChar(NAME_END, j, name)) != OK) return result;
+
+    if (name.length == 0) return FAIL;
+
+    if ((result = matchChars(WHITESPACE, j)) == MORE) return result;
+  }
+
+  // The attributes are only checked; they are decoded by the handler on request
+  while (startTag)
+  {
+    Span key;
+    Span value;
+
+    // The start tag continues with this attribute in the next input
+    _elementName = name;
+    _elementNext = j;
+
+    if ((result = parseAttribute(KEY_END, j, key, value)) != OK) return result;
+
+    if (key.length == 0) break;
+  }
+
+  Span attributes = { name.offset + name.length, j - name.offset - name.length };
+
+  if ((result = matchChar('/', j)) == MORE) return result;
+
+  if (result == OK)
+  {
+    if (endTag) return FAIL;
+
+    endTag = true;
+  }
+
+  if ((result = matchChar('>', j)) != OK) return result;
+
+  if (startTag && _filter.skips(tokenView(name)))
+  {
+    _inText = _filter.hasAllText();
+
+    if (endTag)
+    {
+      if (wants(Callbacks::skipped, XMLParserFilter::SKIPPED)) _handler->skipped(tokenView());
+    }
+    else
+    {
+      _state      = SKIP;
+      _skipLength = name.length;
+      _skipDepth  = 1;
+
+      return OK;
+    }
+  }
+  else if (startTag && endTag)
+  {
+    if (wants(Callbacks::startEndElement, XMLParserFilter::START_END_ELEMENT))
+    {
+      setAttributes(name, attributes);
+
+      _handler->startEndElement(tokenView(), tokenView(name), _attributes);
+    }
+
+    _inText = _filter.hasAllText();
+  }
+  else if (startTag)
+  {
+    if (wants(Callbacks::startElement, XMLParserFilter::START_ELEMENT))
+    {
+      setAttributes(name, attributes);
+
+      _handler->startElement(tokenView(), tokenView(name), _attributes);
+    }
+
+    _inText = _filter.hasText(tokenView(name));
+  }
+  else if (endTag)
+  {
+    if (wants(Callbacks::endElement, XMLParserFilter::END_ELEMENT)) _handler->endElement(tokenView(), tokenView(name));
+
+    _inText = _filter.hasAllText();
+  }
+
+  setState(TEXT);
+
+  return OK;
+}
+
+// Skip the contents till the end tag of the skipped element, counting the
+// nested elements with the same name; the markup is examined till _peek
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::parseSkip()
+{
+  pullAll();
+
+  std::string_view markup = tokenView();
+  std::string_view name   = markup.substr(1, _skipLength);
+
+  size_type j = _peek;
+
+  while ((j = markup.find('<', j)) != std::string_view::npos)
+  {
+    size_type end;
+
+    if (markup.compare(j, 4, "<!--") == 0)
+    {
+      end = markup.find("-->", j + 4);
+      if (end != std::string_view::npos) end += 3;
+    }
+    else if (markup.compare(j, 9, "<![CDATA[") == 0)
+    {
+      end = markup.find("]]>", j + 9);
+      if (end != std::string_view::npos) end += 3;
+    }
+    else
+    {
+      // A '>' in a quoted attribute value does not end the tag
+      end = j + 1;
+      while (end < markup.size() && markup[end] != '>')
+      {
+        if (markup[end] == '"' || markup[end] == '\'')
+        {
+          end = markup.find(markup[end], end + 1);
+          if (end == std::string_view::npos) break;
+        }
+        end++;
+      }
+      end = (end < markup.size() ? end + 1 : std::string_view::npos);
+    }
+
+    if (end == std::string_view::npos) break;
+
+    bool endTag = (markup[j + 1] == '/');
+
+    size_type k = (endTag ? j + 2 : j + 1);
+
+    if (markup.compare(k, name.size(), name) == 0 && NAME_END.contains(markup[k + name.size()]))
+    {
+      if (endTag)
+      {
+        _skipDepth--;
+      }
+      else if (markup[end - 2] != '/')
+      {
+        _skipDepth++;
+      }
+    }
+
+    j = end;
+
+    if (_skipDepth == 0)
+    {
+      _peek = j;
+
+      if (wants(Callbacks::skipped, XMLParserFilter::SKIPPED)) _handler->skipped(std::string_view(token(), _peek));
+
+      setState(TEXT);
+
+      return OK;
+    }
+  }
+
+  // Examine the unfinished markup again with the next input
+  _peek = (j != std::string_view::npos ? j : markup.size());
+
+  return MORE;
+}
+
+// Recognize a simple point element in one go; anything else, also a point
+// that is not complete in the input, is left to parseElement()
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::parsePoint()
+{
+  if (_carried) return FAIL;
+
+  std::string_view data(_in + _start, _inSize - _start);
+
+  auto has = [&](size_type k, std::string_view pattern) { return k <= data.size() && data.compare(k, pattern.size(), pattern) == 0; };
+
+  XMLPoint point;
+
+  size_type j = 1;
+
+  while (j < data.size() && !NAME_END.contains(data[j])) j++;
+
+  point._name = data.substr(1, j - 1);
+
+  if (point._name.empty() || !_filter.isPoint(point._name) || _filter.skips(point._name)) return FAIL;
+
+  // The lat and lon attributes, only with double quotes
+  while (j < data.size() && WHITESPACE.contains(data[j]))
+  {
+    while (j < data.size() && WHITESPACE.contains(data[j])) j++;
+
+    size_type k = j;
+
+    while (k < data.size() && !KEY_END.contains(data[k])) k++;
+
+    std::string_view key = data.substr(j, k - j);
+
+    if (!has(k, "=\"")) return FAIL;
+
+    j = k + 2;
+    k = j;
+
+    while (k < data.size() && !DQUOTE_VALUE_END.contains(data[k])) k++;
+
+    if (!has(k, "\"")) return FAIL;
+
+    std::string_view value = data.substr(j, k - j);
+
+    j = k + 1;
+
+    if (key == "lat" && point._lat.data() == nullptr)
+      point._lat = value;
+    else if (key == "lon" && point._lon.data() == nullptr)
+      point._lon = value;
+    else
+      return FAIL;
+  }
+
+  if (point._lat.data() == nullptr || point._lon.data() == nullptr) return FAIL;
+
+  if (has(j, "/>"))
+  {
+    j += 2;
+  }
+  else if (has(j, ">"))
+  {
+    j++;
+
+    // The ele and time elements, separated by whitespace, till the end tag
+    while (true)
+    {
+      while (j < data.size() && WHITESPACE.contains(data[j])) j++;
+
+      if (has(j, "</"))
+      {
+        j += 2;
+
+        if (!has(j, point._name) || !has(j + point._name.size(), ">")) return FAIL;
+
+        j += point._name.size() + 1;
+        break;
+      }
+
+      std::string_view  child;
+      std::string_view *text;
+
+      if (has(j, "<ele>") && point._ele.data() == nullptr && point._time.data() == nullptr)
+      {
+        child = "ele";
+        text  = &point._ele;
+      }
+      else if (has(j, "<time>") && point._time.data() == nullptr)
+      {
+        child = "time";
+        text  = &point._time;
+      }
+      else
+      {
+        return FAIL;
+      }
+
+      j += child.size() + 2;
+
+      size_type k = data.find('<', j);
+
+      if (k == std::string_view::npos) return FAIL;
+
+      *text = data.substr(j, k - j);
+
+      if (!has(k, "</") || !has(k + 2, child) || !has(k + 2 + child.size(), ">")) return FAIL;
+
+      j = k + child.size() + 3;
+    }
+  }
+  else
+  {
+    return FAIL;
+  }
+
+  _peek = j;
+
+  if (_filter.pointBatchSize() > 0 && Callbacks::pointBatch)
+  {
+    if (!_batch.empty() && _batch._name != point._name) doPoints();
+
+    _batch.add(data.substr(0, j), point, _offset);
+
+    if (_batch.size() >= _filter.pointBatchSize()) doPoints();
+  }
+  else
+  {
+    _handler->point(data.substr(0, j), point);
+  }
+
+  _inText = _filter.hasAllText();
+
+  setState(TEXT);
+
+  return OK;
+}
+
+// Helpers
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::matchChar(char expected, size_type &j)
+{
+  char ch;
+
+  if ((ch = hasChar(j)) == '\0') return MORE;
+
+  if (ch != expected) return FAIL;
+
+  j++;
+
+  return OK;
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::matchChar(const XMLCharClass &chars, size_type &j)
+{
+  char ch;
+
+  if ((ch = hasChar(j)) == '\0') return MORE;
+
+  if (!chars.contains(ch)) return FAIL;
+
+  j++;
+
+  return OK;
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::matchNotChar(const XMLCharClass &chars, size_type &j)
+{
+  char ch;
+
+  if ((ch = hasChar(j)) == '\0') return MORE;
+
+  if (chars.contains(ch)) return FAIL;
+
+  j++;
+
+  return OK;
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::matchString(std::string_view pattern, size_type &j)
+{
+  for (size_type k = 0; k < pattern.size(); k++)
+  {
+    char ch;
+
+    if ((ch = hasChar(j + k)) == '\0') return MORE;
+
+    if (ch != pattern[k]) return FAIL;
+  }
+
+  j += pattern.size();
+
+  return OK;
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::matchChars(const XMLCharClass &chars, size_type &j)
+{
+  size_type k = j;
+
+  Result result;
+
+  while ((result = matchChar(chars, j)) == OK)
+  {
+  }
+
+  if (result == FAIL && j > k) result = OK;
+
+  return result;
+}
+
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::matchNotChars(const XMLCharClass &chars, size_type &j)
+{
+  size_type k = j;
+
+  Result result;
+
+  while ((result = matchNotChar(chars, j)) == OK)
+  {
+  }
+
+  if (result == FAIL && j > k) result = OK;
+
+  return result;
+}
+
+
+// Pattern is processed !
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::skipTillString(std::string_view pattern, size_type &j, Span &text)
+{
+  Result result = FAIL;
+
+  text.offset = j;
+
+  while (result == FAIL)
+  {
+    // Scan the available characters in bulk for the start of the pattern
+    const char *p = nullptr;
+
+    while (j < tokenSize() || pull())
+    {
+      p = static_cast<const char *>(memchr(token() + j, pattern[0], tokenSize() - j));
+
+      if (p != nullptr) break;
+
+      j = tokenSize();
+    }
+
+    if (p == nullptr)
+    {
+      if (j > _peek) _peek = j;
+
+      result = MORE;
+      break;
+    }
+
+    j = p - token();
+
+    if ((result = matchString(pattern, j)) == FAIL) j++;
+  }
+
+  // The markup is only parsed again if the pattern is found in the next input
+  if (result == MORE)
+  {
+    _until = pattern;
+    _scan  = j;
+
+    return MORE;
+  }
+
+  text.length = j - pattern.size() - text.offset;
+
+  return result;
+}
+
+// Till char is not processed !
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::skipTillChar(const XMLCharClass &chars, size_type &j, Span &text)
+{
+  text.offset = j;
+
+  while (j < tokenSize() || pull())
+  {
+    const char *p   = token();
+    size_type   end = tokenSize();
+
+    while (j < end && !chars.contains(p[j])) j++;
+
+    if (j < end)
+    {
+      if (j >= _peek) _peek = j + 1;
+
+      text.length = j - text.offset;
+
+      return OK;
+    }
+  }
+
+  if (j > _peek) _peek = j;
+
+  return MORE;
+}
+
+// Till char is not processed !
+template <typename Handler>
+typename BasicXMLParser<Handler>::Result BasicXMLParser<Handler>::skipTillNotChar(const XMLCharClass &chars, size_type &j, Span &text)
+{
+  Result result = FAIL;
+
+  text.offset = j;
+
+  while ((result = matchNotChar(chars, j)) == FAIL)
+  {
+    j++;
+  }
+
+  if (result == OK) j--;
+
+  text.length = j - text.offset;
+
+  return result;
+}
+
+#endif
@@ -0,0 +1,120 @@
+// ==============================================================================
+//
+//                 GpxPath - the gpx element path class
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// ==============================================================================
+
+#include "GpxPath.h"
+
+GpxPath::GpxPath() :
+  _depth(0)
+{
+}
+
+GpxPath::State GpxPath::push(std::string_view name)
+{
+  State state = next(this->state(), tag(name));
+
+  if (_depth < MAX_DEPTH) _states[_depth] = state;
+
+  _depth++;
+
+  return state;
+}
+
+GpxPath::Tag GpxPath::tag(std::string_view name)
+{
+  switch (name.size())
+  {
+    case 3:
+      if (name == "gpx") return GPX_TAG;
+      if (name == "wpt") return WPT_TAG;
+      if (name == "rte") return RTE_TAG;
+      if (name == "trk") return TRK_TAG;
+      if (name == "ele") return ELE_TAG;
+      break;
+
+    case 4:
+      if (name == "name") return NAME_TAG;
+      if (name == "time") return TIME_TAG;
+      break;
+
+    case 5:
+      if (name == "rtept") return RTEPT_TAG;
+      if (name == "trkpt") return TRKPT_TAG;
+      break;
+
+    case 6:
+      if (name == "trkseg") return TRKSEG_TAG;
+      break;
+  }
+
+  return UNKNOWN_TAG;
+}
+
+GpxPath::State GpxPath::next(State state, Tag tag)
+{
+  switch (state)
+  {
+    case NONE:
+      if (tag == GPX_TAG) return GPX;
+      break;
+
+    case GPX:
+      if (tag == WPT_TAG) return WPT;
+      if (tag == RTE_TAG) return RTE;
+      if (tag == TRK_TAG) return TRK;
+      break;
+
+    case WPT:
+      if (tag == NAME_TAG) return WPT_NAME;
+      if (tag == ELE_TAG)  return WPT_ELE;
+      if (tag == TIME_TAG) return WPT_TIME;
+      break;
+
+    case RTE:
+      if (tag == NAME_TAG)  return RTE_NAME;
+      if (tag == RTEPT_TAG) return RTEPT;
+      break;
+
+    case RTEPT:
+      if (tag == ELE_TAG)  return RTEPT_ELE;
+      if (tag == TIME_TAG) return RTEPT_TIME;
+      break;
+
+    case TRK:
+      if (tag == NAME_TAG)   return TRK_NAME;
+      if (tag == TRKSEG_TAG) return TRKSEG;
+      break;
+
+    case TRKSEG:
+      if (tag == TRKPT_TAG) return TRKPT;
+      break;
+
+    case TRKPT:
+      if (tag == ELE_TAG)  return TRKPT_ELE;
+      if (tag == TIME_TAG) return TRKPT_TIME;
+      break;
+
+    default:
+      break;
+  }
+
+  return OTHER;
+}
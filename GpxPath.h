@@ -0,0 +1,142 @@
+#ifndef GPXPATH_H
+#define GPXPATH_H
+
+//==============================================================================
+//
+//                 GpxPath - the gpx element path class
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//==============================================================================
+
+#include <string_view>
+
+///
+/// @class GpxPath
+///
+/// @brief The path of the current element in a gpx file, kept as a stack of
+///        states instead of a string: "/gpx/trk/trkseg/trkpt" is TRKPT.
+///
+class GpxPath
+{
+public:
+  ///
+  /// The known element names
+  ///
+  enum Tag
+  {
+    UNKNOWN_TAG,
+    GPX_TAG,
+    WPT_TAG,
+    RTE_TAG,
+    RTEPT_TAG,
+    TRK_TAG,
+    TRKSEG_TAG,
+    TRKPT_TAG,
+    NAME_TAG,
+    ELE_TAG,
+    TIME_TAG
+  };
+
+  ///
+  /// The states (paths) of the elements
+  ///
+  enum State
+  {
+    NONE,         // outside the document
+    OTHER,        // any other path
+    GPX,          // /gpx
+    WPT,          // /gpx/wpt
+    WPT_NAME,     // /gpx/wpt/name
+    WPT_ELE,      // /gpx/wpt/ele
+    WPT_TIME,     // /gpx/wpt/time
+    RTE,          // /gpx/rte
+    RTE_NAME,     // /gpx/rte/name
+    RTEPT,        // /gpx/rte/rtept
+    RTEPT_ELE,    // /gpx/rte/rtept/ele
+    RTEPT_TIME,   // /gpx/rte/rtept/time
+    TRK,          // /gpx/trk
+    TRK_NAME,     // /gpx/trk/name
+    TRKSEG,       // /gpx/trk/trkseg
+    TRKPT,        // /gpx/trk/trkseg/trkpt
+    TRKPT_ELE,    // /gpx/trk/trkseg/trkpt/ele
+    TRKPT_TIME    // /gpx/trk/trkseg/trkpt/time
+  };
+
+  ///
+  /// Constructor
+  ///
+  GpxPath();
+
+  ///
+  /// Clear the path
+  ///
+  void clear() { _depth = 0; }
+
+  ///
+  /// Enter an element
+  ///
+  /// @param name      the name of the element
+  ///
+  /// @return the state of the element
+  ///
+  State push(std::string_view name);
+
+  ///
+  /// Leave the current element
+  ///
+  void pop() { if (_depth > 0) _depth--; }
+
+  ///
+  /// Get the state of the current element
+  ///
+  /// @return the state
+  ///
+  State state() const
+  {
+    if (_depth == 0) return NONE;
+
+    return (_depth <= MAX_DEPTH ? _states[_depth - 1] : OTHER);
+  }
+
+  ///
+  /// Get the depth of the current element
+  ///
+  /// @return the depth (0 = outside the document)
+  ///
+  int depth() const { return _depth; }
+
+  ///
+  /// Get the tag of an element name
+  ///
+  /// @param name      the name of the element
+  ///
+  /// @return the tag
+  ///
+  static Tag tag(std::string_view name);
+
+private:
+  static State next(State state, Tag tag);
+
+  // Members
+  static const int MAX_DEPTH = 32;
+
+  State  _states[MAX_DEPTH];
+  int    _depth;
+};
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef GPXPOINTREADER_H
+#define GPXPOINTREADER_H
+
+//==============================================================================
+//
+//                 GpxPointReader - the pull reader of gpx points
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//==============================================================================
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include "XMLNumber.h"
+#include "XMLReader.h"
+#include "GpxPath.h"
+
+///
+/// @class GpxPoint
+///
+/// @brief A waypoint, route point or track point. A missing coordinate or
+///        elevation is std::numeric_limits<double>::min().
+///
+struct GpxPoint
+{
+  GpxPath::State _type;       // WPT, RTEPT or TRKPT
+  double         _lat;
+  double         _lon;
+  double         _ele;
+  std::string    _time;       // the text of the time element
+  unsigned       _segment;    // the number of the route or track segment (1..), 0 for a waypoint
+  std::uint64_t  _offset;     // the byte span of the point element in the document
+  std::uint64_t  _length;
+};
+
+///
+/// @class GpxPointReader
+///
+/// @brief The pull reader of the points in a gpx file: next() returns the next
+///        waypoint, route point or track point. The other elements are
+///        only used for the path; the extensions are skipped.
+///
+class GpxPointReader
+{
+public:
+  ///
+  /// Constructor
+  ///
+  /// @param input       the opened input (read by the reader)
+  ///
+  GpxPointReader(XMLInput &input) :
+    _reader(input),
+    _segment(0),
+    _error(false)
+  {
+    init();
+  }
+
+  ///
+  /// Constructor
+  ///
+  /// @param data        the complete document (valid during the reading)
+  /// @param length      the length of the document
+  ///
+  GpxPointReader(const char *data, size_t length) :
+    _reader(data, length),
+    _segment(0),
+    _error(false)
+  {
+    init();
+  }
+
+  ///
+  /// Read the next point
+  ///
+  /// @return the point (valid till the next call) or nullptr at the end
+  ///
+  const GpxPoint *next();
+
+  ///
+  /// Is the end of the document reached without errors ?
+  ///
+  /// @return is it
+  ///
+  bool isEof() const { return !_error && _reader.isEof(); }
+
+private:
+  void init();
+
+  void start(GpxPath::State state, const XMLEvent *event);
+
+  static double getDouble(std::string_view value);
+
+  static double getDoubleAttribute(const XMLEvent::Attributes *atts, std::string_view key);
+
+  static bool isPoint(GpxPath::State state) { return state == GpxPath::WPT || state == GpxPath::RTEPT || state == GpxPath::TRKPT; }
+
+  // Members
+  XMLReader _reader;
+  GpxPath   _path;
+  GpxPoint  _point;
+  unsigned  _segment;
+  bool      _error;
+
+  // Disable copy constructors
+  GpxPointReader(const GpxPointReader &);
+  GpxPointReader& operator=(const GpxPointReader &);
+};
+
+// -- Implementation ----------------------------------------------------------
+
+// Only the elements, the coordinates and the text of ele and time are needed
+inline void GpxPointReader::init()
+{
+  XMLParserFilter filter;
+
+  filter.setEvents(XMLParserFilter::START_ELEMENT | XMLParserFilter::END_ELEMENT | XMLParserFilter::START_END_ELEMENT |
+                   XMLParserFilter::TEXT | XMLParserFilter::UNHANDLED);
+  filter.setAttributesFor({ "wpt", "rtept", "trkpt" });
+  filter.setTextFor({ "ele", "time" });
+  filter.setSkipFor({ "extensions" });
+
+  _reader.setFilter(filter);
+}
+
+inline const GpxPoint *GpxPointReader::next()
+{
+  const XMLEvent *event;
+
+  while ((event = _reader.next()) != nullptr)
+  {
+    GpxPath::State state;
+
+    switch (event->_type)
+    {
+      case XMLParserFilter::START_ELEMENT:
+        start(_path.push(event->_name), event);
+        break;
+
+      case XMLParserFilter::START_END_ELEMENT:
+        start(state = _path.push(event->_name), event);
+
+        _path.pop();
+
+        if (isPoint(state))
+        {
+          _point._length = event->_text.size();
+
+          return &_point;
+        }
+        break;
+
+      case XMLParserFilter::TEXT:
+        switch (_path.state())
+        {
+          case GpxPath::WPT_ELE:
+          case GpxPath::RTEPT_ELE:
+          case GpxPath::TRKPT_ELE:
+            _point._ele = getDouble(event->_text);
+            break;
+
+          case GpxPath::WPT_TIME:
+          case GpxPath::RTEPT_TIME:
+          case GpxPath::TRKPT_TIME:
+            _point._time.assign(event->_text);
+            break;
+
+          default:
+            break;
+        }
+        break;
+
+      case XMLParserFilter::END_ELEMENT:
+        state = _path.state();
+
+        _path.pop();
+
+        if (isPoint(state))
+        {
+          _point._length = event->_offset + event->_text.size() - _point._offset;
+
+          return &_point;
+        }
+        break;
+
+      case XMLParserFilter::UNHANDLED:
+        _error = true;
+        return nullptr;
+
+      default:
+        break;
+    }
+  }
+
+  return nullptr;
+}
+
+// Start a point or count a route or track segment
+inline void GpxPointReader::start(GpxPath::State state, const XMLEvent *event)
+{
+  if (state == GpxPath::RTE || state == GpxPath::TRKSEG)
+  {
+    _segment++;
+  }
+  else if (isPoint(state))
+  {
+    _point._type    = state;
+    _point._lat     = getDoubleAttribute(event->_attributes, "lat");
+    _point._lon     = getDoubleAttribute(event->_attributes, "lon");
+    _point._ele     = std::numeric_limits<double>::min();
+    _point._time.clear();
+    _point._segment = (state == GpxPath::WPT ? 0 : _segment);
+    _point._offset  = event->_offset;
+    _point._length  = 0;
+  }
+}
+
+inline double GpxPointReader::getDouble(std::string_view value)
+{
+  double result;
+
+  return XMLNumber::toDouble(value, result) ? result : std::numeric_limits<double>::min();
+}
+
+inline double GpxPointReader::getDoubleAttribute(const XMLEvent::Attributes *atts, std::string_view key)
+{
+  if (atts == nullptr) return std::numeric_limits<double>::min();
+
+  double value;
+
+  return atts->getDouble(key, value) ? value : std::numeric_limits<double>::min();
+}
+
+#endif
@@ -0,0 +1,681 @@
+#ifndef PARALLELXMLPARSER_H
+#define PARALLELXMLPARSER_H
+
+//==============================================================================
+//
+//             ParallelXMLParser - the parallel xml parser template class
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//==============================================================================
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "BasicXMLParser.h"
+#include "XMLInput.h"
+
+///
+/// @class XMLEventRecorder
+///
+/// @brief The recorder of the events of a BasicXMLParser in a block of data;
+///        the events are stored as offsets in the block and replayed later.
+///
+class XMLEventRecorder : public BasicXMLParserHandler
+{
+public:
+  ///
+  /// Constructor
+  ///
+  /// @param base        the start of the parsed block
+  ///
+  XMLEventRecorder(const char *base = nullptr) : _base(base), _offset(0) {}
+
+  ///
+  /// Clear the events
+  ///
+  /// @param base        the start of the parsed block
+  /// @param offset      the byte offset of the block in the document
+  ///
+  void clear(const char *base, std::uint64_t offset = 0)
+  {
+    _base   = base;
+    _offset = offset;
+    _events.clear();
+    _attributes.clear();
+  }
+
+  ///
+  /// Replay the events to a handler
+  ///
+  /// @param handler      the handler
+  /// @param lineNumber   the line number of the start of the block
+  /// @param columnNumber the column number of the start of the block
+  /// @param batchSize    the maximum number of points in a batch (0: no batches)
+  ///
+  template <typename Handler>
+  void replay(Handler *handler, int lineNumber, int columnNumber, std::size_t batchSize = 0) const;
+
+  // Callbacks
+  void xmlDecl(std::string_view text, const Attributes &attributes)
+  {
+    record(XMLParserFilter::XML_DECL, text, std::string_view(), std::string_view(), &attributes);
+  }
+
+  void processingInstruction(std::string_view text, std::string_view target, std::string_view value)
+  {
+    record(XMLParserFilter::PROCESSING_INSTRUCTION, text, target, value);
+  }
+
+  void docTypeDecl(std::string_view text)
+  {
+    record(XMLParserFilter::DOCTYPE_DECL, text);
+  }
+
+  void comment(std::string_view text, std::string_view comment)
+  {
+    record(XMLParserFilter::COMMENT, text, comment);
+  }
+
+  void startElement(std::string_view text, std::string_view name, const Attributes &attributes)
+  {
+    record(XMLParserFilter::START_ELEMENT, text, name, std::string_view(), &attributes);
+  }
+
+  void endElement(std::string_view text, std::string_view name)
+  {
+    record(XMLParserFilter::END_ELEMENT, text, name);
+  }
+
+  void startEndElement(std::string_view text, std::string_view name, const Attributes &attributes)
+  {
+    record(XMLParserFilter::START_END_ELEMENT, text, name, std::string_view(), &attributes);
+  }
+
+  void text(std::string_view text)
+  {
+    record(XMLParserFilter::TEXT, text);
+  }
+
+  void cdataDecl(std::string_view text, std::string_view data)
+  {
+    record(XMLParserFilter::CDATA_DECL, text, data);
+  }
+
+  void unhandled(std::string_view text, int lineNumber, int columnNumber)
+  {
+    record(XMLParserFilter::UNHANDLED, text);
+
+    // The position is stored in the first span
+    _events.back()._first._offset = lineNumber;
+    _events.back()._first._length = columnNumber;
+  }
+
+  void skipped(std::string_view text)
+  {
+    record(XMLParserFilter::SKIPPED, text);
+  }
+
+  void point(std::string_view text, const XMLPoint &point)
+  {
+    record(XMLParserFilter::POINT, text, point._name);
+
+    // The coordinates and the ele and time are stored as two attributes
+    _attributes.push_back(std::make_pair(span(point._lat), span(point._lon)));
+    _attributes.push_back(std::make_pair(span(point._ele), span(point._time)));
+
+    _events.back()._count = 2;
+  }
+
+private:
+  typedef std::string::size_type size_type;
+
+  struct Span
+  {
+    size_type _offset;
+    size_type _length;
+  };
+
+  struct Event
+  {
+    XMLParserFilter::Event _type;
+    Span                   _text;
+    Span                   _first;
+    Span                   _second;
+    size_type              _attributes;  // index of the first attribute
+    size_type              _count;       // number of attributes
+    bool                   _raw;         // the attributes are the raw text in _second
+  };
+
+  Span span(std::string_view view) const
+  {
+    if (view.data() == nullptr) return Span { 0, 0 };
+
+    return Span { static_cast<size_type>(view.data() - _base), view.size() };
+  }
+
+  std::string_view view(const Span &span) const { return std::string_view(_base + span._offset, span._length); }
+
+  void record(XMLParserFilter::Event type, std::string_view text, std::string_view first = std::string_view(), std::string_view second = std::string_view(), const Attributes *attributes = nullptr)
+  {
+    Event event = { type, span(text), span(first), span(second), _attributes.size(), 0, false };
+
+    if (attributes != nullptr && attributes->raw().data() != nullptr)
+    {
+      // The attributes are decoded during the replay, if requested
+      event._second = span(attributes->raw());
+      event._raw    = true;
+    }
+    else if (attributes != nullptr)
+    {
+      for (auto iter = attributes->begin(); iter != attributes->end(); ++iter)
+      {
+        _attributes.push_back(std::make_pair(span(iter->first), span(iter->second)));
+      }
+
+      event._count = attributes->size();
+    }
+
+    _events.push_back(event);
+  }
+
+  // Members
+  const char                          *_base;
+  std::uint64_t                        _offset;
+  std::vector<Event>                   _events;
+  std::vector<std::pair<Span, Span> >  _attributes;
+};
+
+///
+/// @class ParallelXMLParser
+///
+/// @brief The parallel parser of a complete xml document in memory. The data
+///        is split in ranges that start at a boundary (example: "<trkpt").
+///        The ranges are parsed by threads and the events are passed to
+///        the handler in document order by the calling thread. A range that
+///        does not end outside markup (e.g. the boundary is in a comment) is
+///        parsed again together with the next range.
+///
+template <typename Handler>
+class ParallelXMLParser
+{
+public:
+  ///
+  /// Constructor
+  ///
+  /// @param handler     the handler
+  ///
+  ParallelXMLParser(Handler *handler = nullptr);
+
+  ///
+  /// Deconstructor
+  ///
+  ~ParallelXMLParser() {}
+
+  // Properties
+
+  ///
+  /// Set the handler
+  ///
+  /// @param handler     the handler
+  ///
+  void setHandler(Handler *handler) { _handler = handler; }
+
+  ///
+  /// Set the filter for the events
+  ///
+  /// @param filter      the filter
+  ///
+  void setFilter(const XMLParserFilter &filter) { _filter = filter; }
+
+  ///
+  /// Set the number of threads
+  ///
+  /// @param threads     the number of threads (default: the number of cores)
+  ///
+  void setThreads(unsigned threads) { _threads = threads; }
+
+  ///
+  /// Set the boundary at which a range starts
+  ///
+  /// @param boundary    the start of the markup (default: "<trkpt")
+  ///
+  void setBoundary(const std::string &boundary) { _boundary = boundary; }
+
+  ///
+  /// Set the minimum size of a range
+  ///
+  /// @param size        the size in bytes
+  ///
+  void setRangeSize(size_t size) { _rangeSize = size; }
+
+  ///
+  /// Get the current line number
+  ///
+  /// @return the current line number
+  ///
+  int lineNumber() const { return _lineNumber; }
+
+  ///
+  /// Get the current column number
+  ///
+  /// @return the current column number
+  ///
+  int columnNumber() const { return _columnNumber; }
+
+  // Parsing methods
+
+  ///
+  /// Parse a complete document
+  ///
+  /// @param  data    the data to be parsed
+  /// @param  length  the length of the data
+  ///
+  /// @return success
+  ///
+  bool parse(const char *data, size_t length);
+
+  ///
+  /// Parse an input; an input that is not memory mapped is parsed by the
+  /// calling thread
+  ///
+  /// @param  input         the opened input
+  ///
+  /// @return success
+  ///
+  bool parse(XMLInput &input);
+
+  ///
+  /// Parse a file
+  ///
+  /// @param  filename      the name of the file
+  ///
+  /// @return success (also false if the file can not be opened)
+  ///
+  bool parseFile(const std::string &filename);
+
+private:
+  struct Range
+  {
+    size_t           _start;
+    size_t           _end;
+    std::thread      _thread;
+    XMLEventRecorder _recorder;
+    bool             _result;
+    bool             _complete;
+    int              _lineNumber;   // the end position relative to the start
+    int              _columnNumber;
+  };
+
+  size_t findBoundary(const char *data, size_t start, size_t length) const;
+
+  void parseRange(const char *data, size_t length, Range &range) const;
+
+  bool parseSequential(const char *data, size_t length);
+
+  // The events that are called on the handler
+  static unsigned events();
+
+  // Members
+  Handler          *_handler;
+  XMLParserFilter   _filter;
+  unsigned          _threads;
+  std::string       _boundary;
+  size_t            _rangeSize;
+
+  int               _lineNumber;
+  int               _columnNumber;
+
+  // Disable copy constructors
+  ParallelXMLParser(const ParallelXMLParser &);
+  ParallelXMLParser& operator=(const ParallelXMLParser &);
+};
+
+// -- Implementation ----------------------------------------------------------
+
+template <typename Handler>
+void XMLEventRecorder::replay(Handler *handler, int lineNumber, int columnNumber, std::size_t batchSize) const
+{
+  Attributes    attributes;
+  XMLPointBatch batch;
+
+  // Pass the batch of points, before the next event
+  auto doPoints = [&]()
+  {
+    if (batch.empty()) return;
+
+    handler->pointBatch(batch);
+
+    batch.clear();
+  };
+
+  for (auto iter = _events.begin(); iter != _events.end(); ++iter)
+  {
+    if (iter->_type != XMLParserFilter::POINT) doPoints();
+
+    if (iter->_raw)
+    {
+      attributes.assign(view(iter->_second));
+    }
+    else
+    {
+      attributes.clear();
+
+      for (size_type i = iter->_attributes; i < iter->_attributes + iter->_count && iter->_type != XMLParserFilter::POINT; i++)
+      {
+        attributes.insert(view(_attributes[i].first), view(_attributes[i].second));
+      }
+    }
+
+    switch (iter->_type)
+    {
+      case XMLParserFilter::XML_DECL:
+        handler->xmlDecl(view(iter->_text), attributes);
+        break;
+
+      case XMLParserFilter::PROCESSING_INSTRUCTION:
+        handler->processingInstruction(view(iter->_text), view(iter->_first), view(iter->_second));
+        break;
+
+      case XMLParserFilter::DOCTYPE_DECL:
+        handler->docTypeDecl(view(iter->_text));
+        break;
+
+      case XMLParserFilter::COMMENT:
+        handler->comment(view(iter->_text), view(iter->_first));
+        break;
+
+      case XMLParserFilter::START_ELEMENT:
+        handler->startElement(view(iter->_text), view(iter->_first), attributes);
+        break;
+
+      case XMLParserFilter::END_ELEMENT:
+        handler->endElement(view(iter->_text), view(iter->_first));
+        break;
+
+      case XMLParserFilter::START_END_ELEMENT:
+        handler->startEndElement(view(iter->_text), view(iter->_first), attributes);
+        break;
+
+      case XMLParserFilter::TEXT:
+        handler->text(view(iter->_text));
+        break;
+
+      case XMLParserFilter::CDATA_DECL:
+        handler->cdataDecl(view(iter->_text), view(iter->_first));
+        break;
+
+      case XMLParserFilter::UNHANDLED:
+      {
+        // The position is relative to the start of the block
+        int line   = static_cast<int>(iter->_first._offset);
+        int column = static_cast<int>(iter->_first._length);
+
+        if (line == 1) column += columnNumber - 1;
+
+        handler->unhandled(view(iter->_text), line + lineNumber - 1, column);
+        break;
+      }
+
+      case XMLParserFilter::SKIPPED:
+        handler->skipped(view(iter->_text));
+        break;
+
+      case XMLParserFilter::POINT:
+      {
+        const auto &coordinates = _attributes[iter->_attributes];
+        const auto &contents    = _attributes[iter->_attributes + 1];
+
+        XMLPoint point = { view(iter->_first), view(coordinates.first), view(coordinates.second), view(contents.first), view(contents.second) };
+
+        if (batchSize > 0 && XMLParserCallbacks<Handler>::pointBatch)
+        {
+          if (!batch.empty() && batch._name != point._name) doPoints();
+
+          batch.add(view(iter->_text), point, _offset + iter->_text._offset);
+
+          if (batch.size() >= batchSize) doPoints();
+        }
+        else
+        {
+          handler->point(view(iter->_text), point);
+        }
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+
+  doPoints();
+}
+
+template <typename Handler>
+ParallelXMLParser<Handler>::ParallelXMLParser(Handler *handler) :
+  _handler(handler),
+  _threads(std::thread::hardware_concurrency()),
+  _boundary("<trkpt"),
+  _rangeSize(1 << 20),
+  _lineNumber(1),
+  _columnNumber(1)
+{
+}
+
+template <typename Handler>
+unsigned ParallelXMLParser<Handler>::events()
+{
+  typedef XMLParserCallbacks<Handler> Callbacks;
+
+  return (Callbacks::xmlDecl               ? XMLParserFilter::XML_DECL               : 0) |
+         (Callbacks::processingInstruction ? XMLParserFilter::PROCESSING_INSTRUCTION : 0) |
+         (Callbacks::docTypeDecl           ? XMLParserFilter::DOCTYPE_DECL           : 0) |
+         (Callbacks::comment               ? XMLParserFilter::COMMENT                : 0) |
+         (Callbacks::startElement          ? XMLParserFilter::START_ELEMENT          : 0) |
+         (Callbacks::endElement            ? XMLParserFilter::END_ELEMENT            : 0) |
+         (Callbacks::startEndElement       ? XMLParserFilter::START_END_ELEMENT      : 0) |
+         (Callbacks::text                  ? XMLParserFilter::TEXT                   : 0) |
+         (Callbacks::cdataDecl             ? XMLParserFilter::CDATA_DECL             : 0) |
+         (Callbacks::unhandled             ? XMLParserFilter::UNHANDLED              : 0) |
+         (Callbacks::skipped               ? XMLParserFilter::SKIPPED                : 0) |
+         (Callbacks::point || Callbacks::pointBatch ? XMLParserFilter::POINT         : 0);
+}
+
+template <typename Handler>
+bool ParallelXMLParser<Handler>::parse(const char *data, size_t length)
+{
+  bool result = true;
+
+  _lineNumber   = 1;
+  _columnNumber = 1;
+
+  // Split the data in ranges
+  std::list<Range> ranges;
+
+  for (size_t start = 0; start < length; )
+  {
+    size_t end = (length - start > 2 * _rangeSize ? findBoundary(data, start + _rangeSize, length) : length);
+
+    ranges.emplace_back();
+    ranges.back()._start = start;
+    ranges.back()._end   = end;
+
+    start = end;
+  }
+
+  if (_threads <= 1 || ranges.size() <= 1) return parseSequential(data, length);
+
+  // Parse the ranges in threads and replay them in order
+  auto     next    = ranges.begin();
+  unsigned running = 0;
+
+  while (!ranges.empty())
+  {
+    for (; next != ranges.end() && running < _threads; ++next, running++)
+    {
+      Range &range = *next;
+
+      range._thread = std::thread([this, data, length, &range]() { parseRange(data, length, range); });
+    }
+
+    Range &range = ranges.front();
+
+    if (range._thread.joinable())
+    {
+      range._thread.join();
+      running--;
+    }
+
+    if (!range._complete)
+    {
+      // The boundary is in markup: parse again with the next range
+      auto following = std::next(ranges.begin());
+
+      if (following->_thread.joinable())
+      {
+        following->_thread.join();
+        running--;
+      }
+
+      if (next == following) ++next;
+
+      range._end = following->_end;
+
+      ranges.erase(following);
+
+      parseRange(data, length, range);
+
+      continue;
+    }
+
+    if (_handler != nullptr) range._recorder.replay(_handler, _lineNumber, _columnNumber, _filter.pointBatchSize());
+
+    if (range._lineNumber == 1)
+    {
+      _columnNumber += range._columnNumber - 1;
+    }
+    else
+    {
+      _lineNumber  += range._lineNumber - 1;
+      _columnNumber = range._columnNumber;
+    }
+
+    if (!range._result) result = false;
+
+    ranges.pop_front();
+  }
+
+  return result;
+}
+
+template <typename Handler>
+bool ParallelXMLParser<Handler>::parse(XMLInput &input)
+{
+  if (!input.isOpen()) return false;
+
+  if (!input.isMapped())
+  {
+    BasicXMLParser<Handler> parser(_handler);
+
+    parser.setFilter(_filter);
+
+    bool result = parser.parse(input);
+
+    _lineNumber   = parser.lineNumber();
+    _columnNumber = parser.columnNumber();
+
+    return result;
+  }
+
+  const char *data;
+  size_t      length;
+
+  if (!input.read(data, length)) return false;
+
+  if (!parse(data, length)) return false;
+
+  return !input.read(data, length) && input.isEof();
+}
+
+template <typename Handler>
+bool ParallelXMLParser<Handler>::parseFile(const std::string &filename)
+{
+  XMLInput input;
+
+  if (!input.open(filename)) return false;
+
+  return parse(input);
+}
+
+// Find the next boundary, followed by the end of the name
+template <typename Handler>
+size_t ParallelXMLParser<Handler>::findBoundary(const char *data, size_t start, size_t length) const
+{
+  std::string_view text(data, length);
+
+  while ((start = text.find(_boundary, start)) != std::string_view::npos)
+  {
+    size_t end = start + _boundary.size();
+
+    if (end < length && strchr(" \t\r\n/>", data[end]) != nullptr) return start;
+
+    start = end;
+  }
+
+  return length;
+}
+
+// Parse a range with its own parser; the events are recorded
+template <typename Handler>
+void ParallelXMLParser<Handler>::parseRange(const char *data, size_t length, Range &range) const
+{
+  XMLParserFilter filter = _filter;
+
+  filter.setEvents(filter.events() & events());
+
+  range._recorder.clear(data + range._start, range._start);
+
+  BasicXMLParser<XMLEventRecorder> parser(&range._recorder);
+
+  parser.setFilter(filter);
+
+  range._result       = parser.parse(data + range._start, range._end - range._start, true);
+  range._complete     = (range._end == length || parser.isComplete());
+  range._lineNumber   = parser.lineNumber();
+  range._columnNumber = parser.columnNumber();
+}
+
+template <typename Handler>
+bool ParallelXMLParser<Handler>::parseSequential(const char *data, size_t length)
+{
+  BasicXMLParser<Handler> parser(_handler);
+
+  parser.setFilter(_filter);
+
+  bool result = parser.parse(data, length, true);
+
+  _lineNumber   = parser.lineNumber();
+  _columnNumber = parser.columnNumber();
+
+  return result;
+}
+
+#endif
@@ -0,0 +1,456 @@
+// ==============================================================================
+//
+//                 XMLInput - the xml input class
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// ==============================================================================
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "XMLInput.h"
+
+namespace
+{
+  const size_t BLOCK_SIZE = 1024 * 1024;
+  const size_t RING_SIZE  = 4;
+
+  // The compressed input is passed to inflate in slices (avail_in is 32 bits)
+  const size_t SLICE_SIZE = UINT_MAX;
+}
+
+XMLInput::XMLInput() :
+  _fd(-1),
+  _owned(false),
+  _eof(false),
+  _mapped(nullptr),
+  _mappedSize(0),
+  _mappedRead(false),
+  _first(0),
+  _count(0),
+  _inUse(false),
+  _readDone(false),
+  _readEof(false),
+  _stop(false),
+  _inputLength(0),
+  _inputEnd(false),
+  _mappedOffset(0),
+  _compressed(false),
+  _memberEnd(false)
+{
+}
+
+XMLInput::~XMLInput()
+{
+  close();
+}
+
+bool XMLInput::open(const std::string &filename)
+{
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+
+  if (fd < 0) return false;
+
+  _fd    = fd;
+  _owned = true;
+
+  map();
+
+  return true;
+}
+
+bool XMLInput::open(int fd)
+{
+  close();
+
+  if (fd < 0) return false;
+
+  _fd    = fd;
+  _owned = false;
+
+  map();
+
+  return true;
+}
+
+void XMLInput::close()
+{
+  stopReader();
+
+  if (_mapped != nullptr)
+  {
+    munmap(_mapped, _mappedSize);
+
+    _mapped = nullptr;
+  }
+
+  if (_fd >= 0 && _owned) ::close(_fd);
+
+  _fd         = -1;
+  _owned      = false;
+  _eof        = false;
+  _mappedSize = 0;
+  _mappedRead = false;
+  _compressed = false;
+}
+
+// Map a regular file; other files are read
+bool XMLInput::map()
+{
+  struct stat status;
+
+  if (fstat(_fd, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size == 0) return false;
+
+  // Only from the start of the file (stdin can be a redirected file)
+  if (lseek(_fd, 0, SEEK_CUR) != 0) return false;
+
+  void *mapped = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+
+  if (mapped == MAP_FAILED) return false;
+
+#ifdef MADV_SEQUENTIAL
+  madvise(mapped, status.st_size, MADV_SEQUENTIAL);
+#endif
+
+  _mapped     = static_cast<char *>(mapped);
+  _mappedSize = status.st_size;
+  _compressed = isGzip(_mapped, _mappedSize);
+
+  return true;
+}
+
+bool XMLInput::read(const char *&data, size_t &length)
+{
+  if (_fd < 0 || _eof) return false;
+
+  if (isMapped())
+  {
+    if (_mappedRead)
+    {
+      _eof = true;
+
+      return false;
+    }
+
+    data        = _mapped;
+    length      = _mappedSize;
+    _mappedRead = true;
+
+    return true;
+  }
+
+  if (!_reader.joinable()) startReader();
+
+  std::unique_lock<std::mutex> lock(_mutex);
+
+  // The block of the previous read is free for the reader
+  if (_inUse)
+  {
+    _first = (_first + 1) % _blocks.size();
+    _count--;
+    _inUse = false;
+
+    _changed.notify_one();
+  }
+
+  _changed.wait(lock, [this] { return _count > 0 || _readDone; });
+
+  if (_count == 0)
+  {
+    _eof = _readEof;
+
+    return false;
+  }
+
+  data   = _blocks[_first]._data.data();
+  length = _blocks[_first]._length;
+  _inUse = true;
+
+  return true;
+}
+
+void XMLInput::startReader()
+{
+  _blocks.resize(RING_SIZE);
+
+  for (auto &block : _blocks) block._data.resize(BLOCK_SIZE);
+
+  _first    = 0;
+  _count    = 0;
+  _inUse    = false;
+  _readDone = false;
+  _readEof  = false;
+  _stop     = false;
+
+  _input.resize(_mapped == nullptr ? BLOCK_SIZE : 0);
+
+  _inputLength  = 0;
+  _inputEnd     = false;
+  _mappedOffset = 0;
+  _memberEnd    = false;
+
+  _reader = std::thread(&XMLInput::readAhead, this);
+}
+
+void XMLInput::stopReader()
+{
+  if (!_reader.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _stop = true;
+  }
+
+  _changed.notify_one();
+
+  _reader.join();
+
+  _blocks.clear();
+  _input.clear();
+
+  if (_stream)
+  {
+    inflateEnd(_stream.get());
+
+    _stream.reset();
+  }
+}
+
+bool XMLInput::isGzip(const char *data, size_t length)
+{
+  return length >= 2 && static_cast<unsigned char>(data[0]) == 0x1f && static_cast<unsigned char>(data[1]) == 0x8b;
+}
+
+// Fill the free blocks in the ring till the end of the file
+void XMLInput::readAhead()
+{
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  int result = 1;
+
+  // The start of an unmapped file shows whether it is compressed
+  if (_mapped == nullptr)
+  {
+    result = readData(_input.data(), _input.size(), _inputLength);
+
+    _inputEnd   = (result == 0);
+    _compressed = isGzip(_input.data(), _inputLength);
+
+    if (result == 0) result = 1;
+  }
+
+  if (_compressed)
+  {
+    _stream.reset(new z_stream);
+
+    memset(_stream.get(), 0, sizeof(z_stream));
+
+    if (_mapped != nullptr)
+    {
+      // The mapping is passed by decompress
+      _stream->next_in  = reinterpret_cast<Bytef *>(_mapped);
+      _stream->avail_in = 0;
+    }
+    else
+    {
+      _stream->next_in  = reinterpret_cast<Bytef *>(_input.data());
+      _stream->avail_in = _inputLength;
+      _inputLength      = 0;
+    }
+
+    // Only gzip, with concatenated members
+    if (inflateInit2(_stream.get(), 16 + MAX_WBITS) != Z_OK) result = -1;
+  }
+
+  std::unique_lock<std::mutex> lock(_mutex);
+
+  while (result > 0)
+  {
+    _changed.wait(lock, [this] { return _count < _blocks.size() || _stop; });
+
+    if (_stop) break;
+
+    Block &block = _blocks[(_first + _count) % _blocks.size()];
+
+    // The block is not used by the parser, so it is filled without the lock
+    lock.unlock();
+
+    result = fill(block);
+
+    lock.lock();
+
+    if (block._length > 0)
+    {
+      _count++;
+
+      _changed.notify_one();
+    }
+  }
+
+  _readEof  = (result == 0);
+  _readDone = true;
+
+  _changed.notify_one();
+}
+
+// Fill a block: 1 if filled, 0 at the end of the file and -1 on error
+int XMLInput::fill(Block &block)
+{
+  if (_compressed) return decompress(block);
+
+  block._length = 0;
+
+  if (_inputLength > 0)
+  {
+    memcpy(block._data.data(), _input.data(), _inputLength);
+
+    block._length = _inputLength;
+    _inputLength  = 0;
+  }
+
+  if (_inputEnd) return 0;
+
+  size_t length;
+
+  int result = readData(block._data.data() + block._length, block._data.size() - block._length, length);
+
+  block._length += length;
+
+  return result;
+}
+
+int XMLInput::decompress(Block &block)
+{
+  block._length = 0;
+
+  while (block._length < block._data.size())
+  {
+    if (_memberEnd)
+    {
+      // The magic of a next member can be split over two reads
+      if (_stream->avail_in < 2 && !_inputEnd)
+      {
+        if (refill() < 0) return -1;
+        continue;
+      }
+
+      // The end of the last member; padding or junk after it is ignored,
+      // as gzip does
+      if (!isGzip(reinterpret_cast<const char *>(_stream->next_in), _stream->avail_in)) return 0;
+
+      inflateReset(_stream.get());
+
+      _memberEnd = false;
+    }
+
+    if (_stream->avail_in == 0 && !_inputEnd)
+    {
+      if (refill() < 0) return -1;
+      continue;
+    }
+
+    _stream->next_out  = reinterpret_cast<Bytef *>(block._data.data() + block._length);
+    _stream->avail_out = block._data.size() - block._length;
+
+    int result = inflate(_stream.get(), Z_NO_FLUSH);
+
+    block._length = block._data.size() - _stream->avail_out;
+
+    if (result == Z_STREAM_END)
+    {
+      // A next member can follow
+      _memberEnd = true;
+    }
+    else if (result != Z_OK)
+    {
+      // Corrupt or truncated
+      return -1;
+    }
+  }
+
+  return 1;
+}
+
+// Pass the next compressed input to inflate, the input that is not used by
+// inflate is kept: 1 if done, -1 on error
+int XMLInput::refill()
+{
+  if (_mapped != nullptr)
+  {
+    size_t offset = _mappedOffset - _stream->avail_in;
+    size_t length = std::min(_mappedSize - offset, SLICE_SIZE);
+
+    _stream->next_in  = reinterpret_cast<Bytef *>(_mapped + offset);
+    _stream->avail_in = length;
+    _mappedOffset     = offset + length;
+    _inputEnd         = (_mappedOffset == _mappedSize);
+
+    return 1;
+  }
+
+  size_t kept = _stream->avail_in;
+
+  memmove(_input.data(), _stream->next_in, kept);
+
+  size_t length;
+
+  int result = readData(_input.data() + kept, _input.size() - kept, length);
+
+  if (result < 0) return -1;
+
+  _inputEnd         = (result == 0);
+  _stream->next_in  = reinterpret_cast<Bytef *>(_input.data());
+  _stream->avail_in = kept + length;
+
+  return 1;
+}
+
+// Read till the data is filled, a pipe returns less per read: 1 if filled,
+// 0 at the end of the file and -1 on error
+int XMLInput::readData(char *data, size_t size, size_t &length)
+{
+  length = 0;
+
+  while (length < size)
+  {
+    ssize_t result = ::read(_fd, data + length, size - length);
+
+    if (result < 0 && errno == EINTR) continue;
+
+    if (result < 0) return -1;
+
+    if (result == 0) return 0;
+
+    length += result;
+  }
+
+  return 1;
+}
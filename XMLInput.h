@@ -0,0 +1,190 @@
+#ifndef XMLINPUT_H
+#define XMLINPUT_H
+
+//==============================================================================
+//
+//                 XMLInput - the xml input class
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//==============================================================================
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct z_stream_s;
+
+///
+/// @class XMLInput
+///
+/// @brief The xml input class: a regular file is memory mapped and returned
+///        in one block, other files (pipes, stdin) are read in large blocks
+///        by a read ahead thread that fills a ring of blocks. A gzip
+///        compressed file (recognized by its magic) is decompressed by the
+///        read ahead thread; it is never returned as mapped.
+///
+class XMLInput
+{
+public:
+
+  ///
+  /// Constructor
+  ///
+  XMLInput();
+
+  ///
+  /// Deconstructor
+  ///
+  virtual ~XMLInput();
+
+  ///
+  /// Open a file
+  ///
+  /// @param filename    the name of the file
+  ///
+  /// @return success
+  ///
+  bool open(const std::string &filename);
+
+  ///
+  /// Open a file descriptor (not closed by the input)
+  ///
+  /// @param fd          the file descriptor (example: STDIN_FILENO)
+  ///
+  /// @return success
+  ///
+  bool open(int fd);
+
+  ///
+  /// Close the input
+  ///
+  void close();
+
+  ///
+  /// Is the input open ?
+  ///
+  /// @return is it
+  ///
+  bool isOpen() const { return _fd >= 0; }
+
+  ///
+  /// Is the input memory mapped ?
+  ///
+  /// @return is it
+  ///
+  bool isMapped() const { return _mapped != nullptr && !_compressed; }
+
+  ///
+  /// Get the memory mapped file
+  ///
+  /// @return the start of the mapped file (nullptr if not mapped)
+  ///
+  const char *mapped() const { return isMapped() ? _mapped : nullptr; }
+
+  ///
+  /// Get the size of the memory mapped file
+  ///
+  /// @return the size
+  ///
+  size_t mappedSize() const { return isMapped() ? _mappedSize : 0; }
+
+  ///
+  /// Get the file descriptor
+  ///
+  /// @return the file descriptor (-1 if not open)
+  ///
+  int fd() const { return _fd; }
+
+  ///
+  /// Read the next block of data
+  ///
+  /// @param data        the start of the block (valid till the next read)
+  /// @param length      the length of the block
+  ///
+  /// @return is there a block (false at the end of the input or on error)
+  ///
+  bool read(const char *&data, size_t &length);
+
+  ///
+  /// Is the end of the input reached without errors ?
+  ///
+  /// @return is it
+  ///
+  bool isEof() const { return _eof; }
+
+private:
+  bool map();
+
+  static bool isGzip(const char *data, size_t length);
+
+  void startReader();
+  void stopReader();
+  void readAhead();
+
+  struct Block;
+
+  int  fill(Block &block);
+  int  decompress(Block &block);
+  int  refill();
+  int  readData(char *data, size_t size, size_t &length);
+
+  // Members
+  int               _fd;
+  bool              _owned;
+  bool              _eof;
+
+  char             *_mapped;
+  size_t            _mappedSize;
+  bool              _mappedRead;
+
+  // The read ahead
+  struct Block
+  {
+    std::vector<char> _data;
+    size_t            _length;
+  };
+
+  std::vector<Block>      _blocks;      // the ring
+  size_t                  _first;       // the block that is read next (or is in use)
+  size_t                  _count;       // the number of filled blocks (including the one in use)
+  bool                    _inUse;       // is the first block returned by read ?
+  bool                    _readDone;    // has the reader stopped ?
+  bool                    _readEof;     // at the end of the file ?
+  bool                    _stop;
+  std::mutex              _mutex;
+  std::condition_variable _changed;
+  std::thread             _reader;
+
+  // The gzip decompression
+  std::vector<char>           _input;        // the start of an unmapped file or the compressed input
+  size_t                      _inputLength;  // the length of the start that is not yet used
+  bool                        _inputEnd;     // is the file read ?
+  size_t                      _mappedOffset; // the end of the mapping passed to inflate
+  bool                        _compressed;   // is the file gzip compressed ?
+  bool                        _memberEnd;    // is a gzip member decompressed ?
+  std::unique_ptr<z_stream_s> _stream;
+
+  // Disable copy constructors
+  XMLInput(const XMLInput &);
+  XMLInput& operator=(const XMLInput &);
+};
+
+#endif
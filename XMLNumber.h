@@ -0,0 +1,106 @@
+#ifndef XMLNUMBER_H
+#define XMLNUMBER_H
+
+//==============================================================================
+//
+//                 XMLNumber - the conversion of numbers in xml text
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//==============================================================================
+
+#include <charconv>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+///
+/// @class XMLNumber
+///
+/// @brief The conversion of decimal numbers in text, accepting the same text
+///        as std::stod and std::stoi: leading whitespace, an optional sign and
+///        the characters after the number are ignored. Unlike std::stod a
+///        hexadecimal floating point number (0x...) fails to convert and the
+///        subnormal numbers are accepted. The conversion does not use the
+///        locale, allocations or exceptions.
+///
+class XMLNumber
+{
+public:
+  ///
+  /// Convert a decimal floating point number
+  ///
+  /// @param text      the text
+  /// @param value     the number (only set on success)
+  ///
+  /// @return success (false if there is no number, it is hexadecimal or it
+  ///         is out of range)
+  ///
+  static bool toDouble(std::string_view text, double &value)
+  {
+    return convert(text, value);
+  }
+
+  ///
+  /// Convert a decimal integer number
+  ///
+  /// @param text      the text
+  /// @param value     the number (only set on success)
+  ///
+  /// @return success (false if there is no number or it is out of range)
+  ///
+  static bool toInt(std::string_view text, int &value)
+  {
+    return convert(text, value);
+  }
+
+private:
+  template <typename T>
+  static bool convert(std::string_view text, T &value)
+  {
+    const char *first = text.data();
+    const char *last  = text.data() + text.size();
+
+    while (first < last && isSpace(*first)) first++;
+
+    // from_chars accepts the minus sign only
+    if (first + 1 < last && first[0] == '+' && first[1] != '-' && first[1] != '+') first++;
+
+    // from_chars reads the 0 of a hexadecimal number, as std::stoi does, but
+    // std::stod reads the hexadecimal number
+    if constexpr (std::is_floating_point<T>::value)
+    {
+      const char *digits = (first < last && *first == '-' ? first + 1 : first);
+
+      if (digits + 1 < last && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) return false;
+    }
+
+    T result;
+
+    std::from_chars_result converted = std::from_chars(first, last, result);
+
+    if (converted.ec != std::errc()) return false;
+
+    value = result;
+
+    return true;
+  }
+
+  static bool isSpace(char ch) { return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' || ch == '\v'; }
+};
+
+#endif
@@ -0,0 +1,656 @@
+// ==============================================================================
+//
+//                 XMLOutput - the xml output class
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// ==============================================================================
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#include <zlib.h>
+
+#include "XMLOutput.h"
+
+namespace
+{
+  const size_t BUFFER_SIZE   = 1024 * 1024;
+
+  // The smaller ranges are copied in the buffer
+  const size_t TRANSFER_SIZE = 64 * 1024;
+
+  // The compressed blocks and the dictionary from the previous block (as pigz)
+  const size_t BLOCK_SIZE      = 256 * 1024;
+  const size_t DICTIONARY_SIZE = 32 * 1024;
+}
+
+// -- Compressor ----------------------------------------------------------------
+
+// The parallel gzip compression: the output is cut in blocks that are deflated
+// by the workers as raw deflate data ending on a byte boundary (Z_SYNC_FLUSH),
+// so the blocks can be concatenated in one deflate stream. The crc's of the
+// blocks are combined.
+class XMLOutput::Compressor
+{
+public:
+  Compressor(XMLOutput &output);
+  ~Compressor();
+
+  void write(const char *data, size_t length);
+  void finish();
+
+private:
+  struct Job
+  {
+    std::vector<char> _dictionary;
+    std::vector<char> _input;
+    std::vector<char> _output;
+    uLong             _crc;
+    bool              _last;
+    bool              _started;
+    bool              _done;
+  };
+
+  void submit(bool last);
+  void writeJobs(size_t pending);
+  void work();
+  static void compress(z_stream &stream, Job &job);
+
+  // Members
+  XMLOutput                        &_output;
+  std::unique_ptr<Job>              _job;       // the block that is filled
+  std::deque<std::unique_ptr<Job>>  _jobs;      // the submitted blocks in output order
+  uLong                             _crc;
+  uLong                             _length;
+  bool                              _stop;
+  std::mutex                        _mutex;
+  std::condition_variable           _changed;
+  std::vector<std::thread>          _workers;
+};
+
+XMLOutput::Compressor::Compressor(XMLOutput &output) :
+  _output(output),
+  _job(new Job),
+  _crc(crc32(0, Z_NULL, 0)),
+  _length(0),
+  _stop(false)
+{
+  static const char header[] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, 3 };
+
+  _output.writeFile(header, sizeof(header));
+
+  _job->_input.reserve(BLOCK_SIZE);
+
+  unsigned workers = std::thread::hardware_concurrency();
+
+  if (workers == 0) workers = 1;
+
+  for (unsigned i = 0; i < workers; i++) _workers.emplace_back(&Compressor::work, this);
+}
+
+XMLOutput::Compressor::~Compressor()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _stop = true;
+  }
+
+  _changed.notify_all();
+
+  for (auto &worker : _workers) worker.join();
+}
+
+void XMLOutput::Compressor::write(const char *data, size_t length)
+{
+  while (length > 0)
+  {
+    size_t size = std::min(length, BLOCK_SIZE - _job->_input.size());
+
+    _job->_input.insert(_job->_input.end(), data, data + size);
+
+    data   += size;
+    length -= size;
+
+    if (_job->_input.size() == BLOCK_SIZE) submit(false);
+  }
+}
+
+// Compress the last block and write the trailer
+void XMLOutput::Compressor::finish()
+{
+  submit(true);
+
+  writeJobs(0);
+
+  unsigned char trailer[8];
+
+  for (int i = 0; i < 4; i++)
+  {
+    trailer[i]     = (_crc    >> (8 * i)) & 0xff;
+    trailer[i + 4] = (_length >> (8 * i)) & 0xff;
+  }
+
+  _output.writeFile(reinterpret_cast<const char *>(trailer), sizeof(trailer));
+}
+
+void XMLOutput::Compressor::submit(bool last)
+{
+  std::unique_ptr<Job> next(new Job);
+
+  next->_input.reserve(BLOCK_SIZE);
+
+  // The end of the block is the dictionary of the next block
+  size_t size = std::min(_job->_input.size(), DICTIONARY_SIZE);
+
+  next->_dictionary.assign(_job->_input.end() - size, _job->_input.end());
+
+  _job->_last    = last;
+  _job->_started = false;
+  _job->_done    = false;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _jobs.push_back(std::move(_job));
+  }
+
+  _changed.notify_all();
+
+  _job = std::move(next);
+
+  // Limit the blocks in progress
+  writeJobs(2 * _workers.size());
+}
+
+// Write the compressed blocks in order, till there are pending blocks left
+void XMLOutput::Compressor::writeJobs(size_t pending)
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+
+  while (!_jobs.empty() && (_jobs.front()->_done || _jobs.size() > pending))
+  {
+    _changed.wait(lock, [this] { return _jobs.front()->_done; });
+
+    std::unique_ptr<Job> job = std::move(_jobs.front());
+
+    _jobs.pop_front();
+
+    lock.unlock();
+
+    _output.writeFile(job->_output.data(), job->_output.size());
+
+    _crc     = crc32_combine(_crc, job->_crc, job->_input.size());
+    _length += job->_input.size();
+
+    lock.lock();
+  }
+}
+
+void XMLOutput::Compressor::work()
+{
+  z_stream stream;
+
+  memset(&stream, 0, sizeof(stream));
+
+  bool ok = (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+
+  std::unique_lock<std::mutex> lock(_mutex);
+
+  while (true)
+  {
+    Job *job = nullptr;
+
+    _changed.wait(lock, [this, &job]
+    {
+      for (auto &waiting : _jobs)
+      {
+        if (!waiting->_started)
+        {
+          job = waiting.get();
+          return true;
+        }
+      }
+
+      return _stop;
+    });
+
+    if (job == nullptr) break;
+
+    job->_started = true;
+
+    lock.unlock();
+
+    if (ok)
+    {
+      deflateReset(&stream);
+
+      compress(stream, *job);
+    }
+
+    lock.lock();
+
+    job->_done = true;
+
+    _changed.notify_all();
+  }
+
+  if (ok) deflateEnd(&stream);
+}
+
+void XMLOutput::Compressor::compress(z_stream &stream, Job &job)
+{
+  job._crc = crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef *>(job._input.data()), job._input.size());
+
+  if (!job._dictionary.empty())
+  {
+    deflateSetDictionary(&stream, reinterpret_cast<const Bytef *>(job._dictionary.data()), job._dictionary.size());
+  }
+
+  // The bound with room for the flush markers
+  job._output.resize(deflateBound(&stream, job._input.size()) + 16);
+
+  stream.next_in   = reinterpret_cast<Bytef *>(job._input.data());
+  stream.avail_in  = job._input.size();
+  stream.next_out  = reinterpret_cast<Bytef *>(job._output.data());
+  stream.avail_out = job._output.size();
+
+  int flush = (job._last ? Z_FINISH : Z_SYNC_FLUSH);
+
+  while (deflate(&stream, flush) != Z_STREAM_END && stream.avail_out == 0)
+  {
+    size_t used = job._output.size();
+
+    job._output.resize(2 * used);
+
+    stream.next_out  = reinterpret_cast<Bytef *>(job._output.data() + used);
+    stream.avail_out = job._output.size() - used;
+  }
+
+  job._output.resize(job._output.size() - stream.avail_out);
+}
+
+// -- XMLOutput -----------------------------------------------------------------
+
+XMLOutput::XMLOutput() :
+  _fd(-1),
+  _owned(false),
+  _good(true),
+  _mapped(nullptr),
+  _mappedSize(0),
+  _mappedFd(-1),
+  _rangeOffset(0),
+  _rangeLength(0),
+  _bufferSize(0)
+{
+}
+
+XMLOutput::~XMLOutput()
+{
+  close();
+}
+
+bool XMLOutput::open(const std::string &filename)
+{
+  close();
+
+  int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+  if (fd < 0) return false;
+
+  _fd    = fd;
+  _owned = true;
+
+  // The extension .gz is written compressed
+  if (filename.size() > 3 && filename.compare(filename.size() - 3, 3, ".gz") == 0) _compressor.reset(new Compressor(*this));
+
+  return true;
+}
+
+bool XMLOutput::open(int fd)
+{
+  close();
+
+  if (fd < 0) return false;
+
+  _fd    = fd;
+  _owned = false;
+
+  return true;
+}
+
+bool XMLOutput::close()
+{
+  flush();
+
+  if (_compressor)
+  {
+    _compressor->finish();
+
+    _compressor.reset();
+  }
+
+  bool result = _good;
+
+  if (_fd >= 0 && _owned && ::close(_fd) != 0) result = false;
+
+  _fd    = -1;
+  _owned = false;
+  _good  = true;
+
+  return result;
+}
+
+void XMLOutput::setInput(const XMLInput *input)
+{
+  writeRange();
+
+  if (input != nullptr && input->isMapped())
+  {
+    _mapped     = input->mapped();
+    _mappedSize = input->mappedSize();
+    _mappedFd   = input->fd();
+  }
+  else
+  {
+    _mapped     = nullptr;
+    _mappedSize = 0;
+    _mappedFd   = -1;
+  }
+}
+
+void XMLOutput::write(std::string_view text)
+{
+  if (text.empty()) return;
+
+  if (isMapped(text))
+  {
+    copy(text.data() - _mapped, text.size());
+  }
+  else
+  {
+    writeRange();
+
+    buffer(text.data(), text.size());
+  }
+}
+
+void XMLOutput::write(const XMLOutputPart &part)
+{
+  if (part._length > 0)
+  {
+    copy(part._offset, part._length);
+  }
+  else
+  {
+    write(part._text);
+  }
+}
+
+void XMLOutput::append(XMLOutputPart &part, std::string_view text) const
+{
+  if (text.empty()) return;
+
+  if (part._text.empty() && isMapped(text))
+  {
+    std::uint64_t offset = text.data() - _mapped;
+
+    if (part._length == 0)
+    {
+      part._offset = offset;
+      part._length = text.size();
+      return;
+    }
+
+    if (part._offset + part._length == offset)
+    {
+      part._length += text.size();
+      return;
+    }
+  }
+
+  // Not a continuation of the range: the part becomes a copy
+  if (part._length > 0)
+  {
+    part._text.assign(_mapped + part._offset, part._length);
+
+    part._length = 0;
+  }
+
+  part._text.append(text);
+}
+
+void XMLOutput::writeInt(long long value, int width)
+{
+  char text[32];
+
+  std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+
+  size_t length = result.ptr - text;
+
+  if (static_cast<size_t>(width) > length) writeSpaces(width - length);
+
+  write(std::string_view(text, length));
+}
+
+void XMLOutput::writeFixed(double value, int precision, int width)
+{
+  // The largest double has 309 digits
+  char text[512];
+
+  std::to_chars_result result = std::to_chars(text, text + sizeof(text), value, std::chars_format::fixed, precision);
+
+  if (result.ec != std::errc()) return;
+
+  size_t length = result.ptr - text;
+
+  if (static_cast<size_t>(width) > length) writeSpaces(width - length);
+
+  write(std::string_view(text, length));
+}
+
+void XMLOutput::writeShortest(double value)
+{
+  char text[32];
+
+  std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+
+  if (result.ec != std::errc()) return;
+
+  write(std::string_view(text, result.ptr - text));
+}
+
+void XMLOutput::writeSpaces(size_t count)
+{
+  static const char spaces[] = "                                ";
+
+  while (count > 0)
+  {
+    size_t length = std::min(count, sizeof(spaces) - 1);
+
+    write(std::string_view(spaces, length));
+
+    count -= length;
+  }
+}
+
+bool XMLOutput::flush()
+{
+  writeRange();
+
+  writeBuffer();
+
+  return _good;
+}
+
+// Extend the pending range or start a new one
+void XMLOutput::copy(std::uint64_t offset, std::uint64_t length)
+{
+  if (_rangeLength > 0 && _rangeOffset + _rangeLength == offset)
+  {
+    _rangeLength += length;
+  }
+  else
+  {
+    writeRange();
+
+    _rangeOffset = offset;
+    _rangeLength = length;
+  }
+}
+
+void XMLOutput::writeRange()
+{
+  if (_rangeLength == 0) return;
+
+  if (_rangeLength < TRANSFER_SIZE)
+  {
+    buffer(_mapped + _rangeOffset, _rangeLength);
+  }
+  else
+  {
+    writeBuffer();
+
+    transfer(_rangeOffset, _rangeLength);
+  }
+
+  _rangeLength = 0;
+}
+
+// Copy a range of the input file by the kernel: copy_file_range for files,
+// sendfile for the other outputs (both on linux only) and else a write from
+// the mapped input
+void XMLOutput::transfer(std::uint64_t offset, std::uint64_t length)
+{
+  if (_fd < 0 || !_good) return;
+
+  if (_compressor)
+  {
+    writeData(_mapped + offset, length);
+    return;
+  }
+
+  std::uint64_t done = offset;
+
+#ifdef HAVE_COPY_FILE_RANGE
+  loff_t copied = done;
+
+  while (length > 0)
+  {
+    ssize_t result = copy_file_range(_mappedFd, &copied, _fd, nullptr, length, 0);
+
+    if (result < 0 && errno == EINTR) continue;
+
+    if (result <= 0) break;
+
+    length -= result;
+  }
+
+  done = copied;
+#endif
+
+#ifdef __linux__
+  off_t sent = done;
+
+  while (length > 0)
+  {
+    ssize_t result = sendfile(_fd, _mappedFd, &sent, length);
+
+    if (result < 0 && errno == EINTR) continue;
+
+    if (result <= 0) break;
+
+    length -= result;
+  }
+
+  done = sent;
+#endif
+
+  if (length > 0) writeData(_mapped + done, length);
+}
+
+void XMLOutput::buffer(const char *data, size_t length)
+{
+  if (_bufferSize + length > BUFFER_SIZE) writeBuffer();
+
+  if (length >= BUFFER_SIZE)
+  {
+    writeData(data, length);
+  }
+  else
+  {
+    if (_buffer.size() < BUFFER_SIZE) _buffer.resize(BUFFER_SIZE);
+
+    memcpy(_buffer.data() + _bufferSize, data, length);
+
+    _bufferSize += length;
+  }
+}
+
+void XMLOutput::writeBuffer()
+{
+  if (_bufferSize == 0) return;
+
+  writeData(_buffer.data(), _bufferSize);
+
+  _bufferSize = 0;
+}
+
+void XMLOutput::writeData(const char *data, size_t length)
+{
+  if (_compressor)
+  {
+    _compressor->write(data, length);
+  }
+  else
+  {
+    writeFile(data, length);
+  }
+}
+
+void XMLOutput::writeFile(const char *data, size_t length)
+{
+  if (_fd < 0 || !_good) return;
+
+  while (length > 0)
+  {
+    ssize_t result = ::write(_fd, data, length);
+
+    if (result < 0 && errno == EINTR) continue;
+
+    if (result <= 0)
+    {
+      _good = false;
+      return;
+    }
+
+    data   += result;
+    length -= result;
+  }
+}
@@ -0,0 +1,255 @@
+#ifndef XMLOUTPUT_H
+#define XMLOUTPUT_H
+
+//==============================================================================
+//
+//                 XMLOutput - the xml output class
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//==============================================================================
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "XMLInput.h"
+
+///
+/// @class XMLOutputPart
+///
+/// @brief A part of the output that is held before it is written: a byte
+///        range of the memory mapped input or, for other text, a copy.
+///        It is filled by XMLOutput::append and written by XMLOutput::write.
+///
+class XMLOutputPart
+{
+public:
+  ///
+  /// Constructor
+  ///
+  XMLOutputPart() : _offset(0), _length(0) {}
+
+  ///
+  /// Clear the part
+  ///
+  void clear() { _offset = 0; _length = 0; _text.clear(); }
+
+  ///
+  /// Is the part empty ?
+  ///
+  /// @return is it
+  ///
+  bool empty() const { return _length == 0 && _text.empty(); }
+
+private:
+  friend class XMLOutput;
+
+  // Members
+  std::uint64_t _offset;      // the range in the mapped input
+  std::uint64_t _length;
+  std::string   _text;        // or the copied text
+};
+
+///
+/// @class XMLOutput
+///
+/// @brief The xml output class: the text is buffered and written with large
+///        writes. Text that is a view in the memory mapped input (as the text
+///        of the parser events is) is not copied, but collected in byte ranges
+///        of the input. The large ranges are copied by the kernel from the
+///        input file (copy_file_range or sendfile), so the unchanged parts of
+///        a document are written without passing through the tool.
+///        The numbers are formatted without the iostreams and their locale.
+///        A file with the extension .gz is written gzip compressed: blocks of
+///        the output are deflated in parallel by worker threads and written
+///        as one gzip stream.
+///
+class XMLOutput
+{
+public:
+  ///
+  /// Constructor
+  ///
+  XMLOutput();
+
+  ///
+  /// Deconstructor (writes the pending output)
+  ///
+  virtual ~XMLOutput();
+
+  ///
+  /// Open (create or truncate) a file; a file with the extension .gz is
+  /// written gzip compressed
+  ///
+  /// @param filename    the name of the file
+  ///
+  /// @return success
+  ///
+  bool open(const std::string &filename);
+
+  ///
+  /// Open a file descriptor (not closed by the output)
+  ///
+  /// @param fd          the file descriptor (example: STDOUT_FILENO)
+  ///
+  /// @return success
+  ///
+  bool open(int fd);
+
+  ///
+  /// Write the pending output and close the output
+  ///
+  /// @return are all writes successful ?
+  ///
+  bool close();
+
+  ///
+  /// Is the output open ?
+  ///
+  /// @return is it
+  ///
+  bool isOpen() const { return _fd >= 0; }
+
+  ///
+  /// Set the input whose mapped text is written as byte ranges; the pending
+  /// ranges of the previous input are written first, the parts that are
+  /// still held with ranges of that input become invalid
+  ///
+  /// @param input       the input (or nullptr for none)
+  ///
+  void setInput(const XMLInput *input);
+
+  ///
+  /// Write text
+  ///
+  /// @param text        the text (a range if it is a view in the mapped input)
+  ///
+  void write(std::string_view text);
+
+  ///
+  /// Write a character
+  ///
+  /// @param ch          the character
+  ///
+  void put(char ch)
+  {
+    if (_rangeLength == 0 && _bufferSize < _buffer.size())
+    {
+      _buffer[_bufferSize++] = ch;
+    }
+    else
+    {
+      write(std::string_view(&ch, 1));
+    }
+  }
+
+  ///
+  /// Write an integer number
+  ///
+  /// @param value       the number
+  /// @param width       the minimal width (right aligned with spaces)
+  ///
+  void writeInt(long long value, int width = 0);
+
+  ///
+  /// Write a floating point number in fixed notation, as printf("%*.*f")
+  ///
+  /// @param value       the number
+  /// @param precision   the number of decimals
+  /// @param width       the minimal width (right aligned with spaces)
+  ///
+  void writeFixed(double value, int precision, int width = 0);
+
+  ///
+  /// Write a floating point number in the shortest notation that reads
+  /// back as the same number
+  ///
+  /// @param value       the number
+  ///
+  void writeShortest(double value);
+
+  ///
+  /// Write spaces
+  ///
+  /// @param count       the number of spaces
+  ///
+  void writeSpaces(size_t count);
+
+  ///
+  /// Write a held part
+  ///
+  /// @param part        the part
+  ///
+  void write(const XMLOutputPart &part);
+
+  ///
+  /// Append text to a held part
+  ///
+  /// @param part        the part
+  /// @param text        the text (a range if it is a view in the mapped input)
+  ///
+  void append(XMLOutputPart &part, std::string_view text) const;
+
+  ///
+  /// Write the pending output
+  ///
+  /// @return are all writes successful ?
+  ///
+  bool flush();
+
+private:
+  bool isMapped(std::string_view text) const
+  {
+    return _mapped != nullptr && text.data() >= _mapped && text.data() + text.size() <= _mapped + _mappedSize;
+  }
+
+  void copy(std::uint64_t offset, std::uint64_t length);
+  void writeRange();
+  void transfer(std::uint64_t offset, std::uint64_t length);
+  void buffer(const char *data, size_t length);
+  void writeBuffer();
+  void writeData(const char *data, size_t length);
+  void writeFile(const char *data, size_t length);
+
+  class Compressor;
+
+  // Members
+  int               _fd;
+  bool              _owned;
+  bool              _good;
+
+  const char       *_mapped;        // the mapped input
+  size_t            _mappedSize;
+  int               _mappedFd;
+
+  std::uint64_t     _rangeOffset;   // the pending range in the mapped input
+  std::uint64_t     _rangeLength;
+
+  std::vector<char> _buffer;
+  size_t            _bufferSize;
+
+  std::unique_ptr<Compressor> _compressor;
+
+  // Disable copy constructors
+  XMLOutput(const XMLOutput &);
+  XMLOutput& operator=(const XMLOutput &);
+};
+
+#endif
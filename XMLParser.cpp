@@ -22,96 +22,52 @@
 
 #include "XMLParser.h"
 
+template class BasicXMLParser<XMLParserViewHandler>;
+
 XMLParser::XMLParser() :
-  _handler(nullptr),
-  _state(TEXT),
-  _lineNumber(1),
-  _columnNumber(1)
+  BasicXMLParser<XMLParserViewHandler>()
 {
 }
 
 XMLParser::XMLParser(XMLParserHandler *handler) :
-  _handler(handler),
-  _state(TEXT),
-  _lineNumber(1),
-  _columnNumber(1)
+  BasicXMLParser<XMLParserViewHandler>()
 {
+  setHandler(handler);
 }
 
-XMLParser::~XMLParser()
+XMLParser::XMLParser(XMLParserViewHandler *handler) :
+  BasicXMLParser<XMLParserViewHandler>(handler)
 {
 }
 
-bool XMLParser::parse(const std::string &in, bool isFinal)
+XMLParser::~XMLParser()
 {
-  Result result = OK;
-
-  std::string::size_type i = 0;
-  while (i < in.size() && result == OK)
-  {
-    switch(_state)
-    {
-      case TEXT:   result = parseText  (in, i); break;
-      case MARKUP: result = parseMarkup(in, i); break;
-    }
-  }
-
-  if (isFinal)
-  {
-    if (_state == TEXT && result != FAIL)
-    {
-      if (_handler != nullptr && !_out.empty()) _handler->text(_out);
-    }
-
-    if (_state == MARKUP)
-    {
-      if (_handler != nullptr && !_out.empty()) _handler->unhandled(_out, _lineNumber, _columnNumber);
-    }
-  }
-
-  return (result == OK || result == MORE);
 }
 
-bool XMLParser::parse(const char *data, size_t length, bool isFinal)
+void XMLParser::setHandler(XMLParserHandler *handler)
 {
-  return parse(std::string(data, length), isFinal);
-}
+  _adapter.setHandler(handler);
 
-bool XMLParser::parse(const char *text, bool isFinal)
-{
-  return parse(std::string(text), isFinal);
+  setHandler(handler != nullptr ? &_adapter : nullptr);
 }
 
-bool XMLParser::parse(std::istream &stream)
+// Text processing
+std::string XMLParser::trim(const std::string &text)
 {
-  if (!stream.good()) return false;
-
-  char buffer[4096];
-
-  while (stream.good())
-  {
-    stream.read(buffer, sizeof(buffer));
-
-    if (!parse(buffer, stream.gcount(), (stream.gcount() < sizeof(buffer)))) return false;
-  }
+  std::size_t start = text.find_first_not_of(" \t\r\n");
 
-  return true;
-}
+  if (start == std::string::npos) return std::string();
 
-// Set the state
-void XMLParser::setState(State state)
-{
-  _state = state;
+  std::size_t end   = text.find_last_not_of(" \t\r\n");
 
-  _out.clear();
+  return text.substr(start, end - start + 1);
 }
 
-// Text processing
-std::string XMLParser::trim(const std::string &text)
+std::string_view XMLParser::trim(std::string_view text)
 {
   std::size_t start = text.find_first_not_of(" \t\r\n");
 
-  if (start == std::string::npos) return std::string();
+  if (start == std::string_view::npos) return std::string_view();
 
   std::size_t end   = text.find_last_not_of(" \t\r\n");
 
@@ -131,479 +87,181 @@ void XMLParser::translateEntityRef(std::string &text, const std::string &pattern
 
 std::string XMLParser::translateEntityRefs(const std::string &text)
 {
-  std::string result = text;
-
-  translateEntityRef(result, "&lt;",   "<");
-  translateEntityRef(result, "&gt;",   ">");
-  translateEntityRef(result, "&apos;", "'");
-  translateEntityRef(result, "&quot;", "\"");
-  translateEntityRef(result, "&amp;",  "&");
-
-  return result;
-}
-
-// XML Parsing
-char XMLParser::hasChar(const std::string &in,  std::string::size_type &i)
-{
-  if (i == in.size()) return '\0';
-
-  char ch = in[i++];
+  std::string buffer;
 
-  if (ch == '\n')
-  {
-    _columnNumber = 1;
-    _lineNumber++;
-  }
-  else
-  {
-    _columnNumber++;
-  }
-
-  return ch;
+  return std::string(decodeEntityRefs(text, buffer));
 }
 
-char XMLParser::hasChar(const std::string &in,        std::string::size_type &i,
-                              std::string &out,       std::string::size_type  j)
+std::string_view XMLParser::decodeEntityRefs(std::string_view text, std::string &buffer)
 {
-  if (j < out.size()) return out[j];
-
-  char ch = hasChar(in, i);
-
-  if (ch != '\0') out.push_back(ch);
-
-  return ch;
-}
+  std::size_t i = text.find('&');
 
+  if (i == std::string_view::npos) return text;
 
-XMLParser::Result XMLParser::parseText(const std::string &in, std::string::size_type &i)
-{
-  char ch;
+  buffer.assign(text.data(), i);
 
-  while ((ch = hasChar(in, i)) != '\0')
+  while (i < text.size())
   {
-    if (ch == '<')
-    {
-      if (!_out.empty())
-      {
-        if (_handler != nullptr) _handler->text(_out);
-      }
-      _state = MARKUP;
-
-      _out = ch;
+    // The reference is short, so the ';' is only looked for nearby
+    std::size_t end = text.substr(i + 1, 12).find(';');
 
-      break;
+    if (end != std::string_view::npos && decodeEntityRef(text.substr(i + 1, end), buffer))
+    {
+      i += end + 2;
     }
     else
     {
-      _out.push_back(ch);
+      buffer += '&';
+      i++;
     }
-  }
 
-  return (ch == '\0' ? MORE : OK);
-}
-
-XMLParser::Result XMLParser::parseMarkup(const std::string &in, std::string::size_type &i)
-{
-  Result result = FAIL;
+    std::size_t next = text.find('&', i);
 
-  if (result == FAIL) result = parseDeclaration(in, i);
+    if (next == std::string_view::npos) next = text.size();
 
-  if (result == FAIL) result = parseSection(in, i);
-
-  if (result == FAIL) result = parseElement(in, i);
-
-  if (result == FAIL) result = doUnhandled();
-
-  return result;
-}
-
-XMLParser::Result XMLParser::doUnhandled()
-{
-  if (_handler != nullptr) _handler->unhandled(_out, _lineNumber, _columnNumber);
+    buffer.append(text.data() + i, next - i);
 
-  setState(TEXT);
+    i = next;
+  }
 
-  return OK;
+  return buffer;
 }
 
-XMLParser::Result XMLParser::parseDeclaration(const std::string &in, std::string::size_type &i)
+// Append the character of the entity reference (without '&' and ';')
+bool XMLParser::decodeEntityRef(std::string_view name, std::string &buffer)
 {
-  std::string::size_type j = 1;
-
-  Result result;
+  if (name == "lt")   { buffer += '<';  return true; }
+  if (name == "gt")   { buffer += '>';  return true; }
+  if (name == "apos") { buffer += '\''; return true; }
+  if (name == "quot") { buffer += '"';  return true; }
+  if (name == "amp")  { buffer += '&';  return true; }
 
-  std::string target;
+  if (name.size() < 2 || name[0] != '#') return false;
 
-  if ((result = matchChar("?", in, i, _out, j)) != OK) return result;
+  bool          hex   = (name[1] == 'x');
+  std::size_t   k     = (hex ? 2 : 1);
+  unsigned long value = 0;
 
-  if ((result = skipTillChar(" \t\n\r?>", in, i, _out, j, target)) != OK) return result;
+  if (k == name.size()) return false;
 
-  if (target == "xml") // XMLDecl
+  for (; k < name.size(); k++)
   {
-    if ((result = matchChars(" \t\n\r", in, i, _out, j)) == MORE) return result;
+    char ch = name[k];
 
-    XMLParserHandler::Attributes attributes;
-
-    while (true)
+    if (ch >= '0' && ch <= '9')
     {
-      std::string                  key;
-      std::string                  value;
-
-      if ((result = parseAttribute(" \t\n\r=?>", in, i, _out, j, key, value)) != OK) return result;
-
-      if (key.empty()) break;
-
-      attributes.insert(std::make_pair(key, value));
+      value = value * (hex ? 16 : 10) + (ch - '0');
+    }
+    else if (hex && ch >= 'a' && ch <= 'f')
+    {
+      value = value * 16 + (ch - 'a' + 10);
+    }
+    else if (hex && ch >= 'A' && ch <= 'F')
+    {
+      value = value * 16 + (ch - 'A' + 10);
+    }
+    else
+    {
+      return false;
     }
 
-    if ((result = matchString("?>", in, i, _out, j)) != OK) return result;
-
-    if (_handler != nullptr) _handler->xmlDecl(_out, attributes);
+    if (value > 0x10FFFF) return false;
   }
-  else // Processing instruction
-  {
-    std::string value;
-
-    if ((result = skipTillChar(" \t\r\n?>", in, i, _out, j, target)) != OK) return result;
-
-    if (target.empty()) return FAIL;
 
-    if ((result = matchChars(" \t\r\n", in, i, _out, j)) == MORE) return result;
+  if (value == 0 || (value >= 0xD800 && value <= 0xDFFF)) return false;
 
-    if ((result = skipTillString("?>", in, i, _out, j, value)) != OK) return result;
-
-    if (_handler != nullptr) _handler->processingInstruction(_out, target, value);
+  // UTF-8
+  if (value < 0x80)
+  {
+    buffer += static_cast<char>(value);
   }
-
-  setState(TEXT);
-
-  return OK;
-}
-
-XMLParser::Result XMLParser::parseSection(const std::string &in, std::string::size_type &i)
-{
-  std::string::size_type j = 1;
-
-  Result result;
-
-  if ((result = matchChar("!", in, i, _out, j)) != OK) return result;
-
-  if ((result = matchString("--", in, i, _out, j)) == MORE) return result;
-
-  if (result == OK) // Comment
+  else if (value < 0x800)
   {
-    std::string text;
-
-    text.clear();
-
-    if ((result = skipTillString("-->", in, i, _out, j, text)) != OK) return result;
-
-    if (_handler != nullptr) _handler->comment(_out, text);
-
-    setState(TEXT);
-
-    return OK;
+    buffer += static_cast<char>(0xC0 | (value >> 6));
+    buffer += static_cast<char>(0x80 | (value & 0x3F));
   }
-
-  if ((result = matchString("[CDATA[", in, i, _out, j)) == MORE) return result;
-
-  if (result == OK)
+  else if (value < 0x10000)
   {
-    std::string text;
-
-    text.clear();
-
-    if ((result = skipTillString("]]>", in, i, _out, j, text)) != OK) return result;
-
-    if (_handler != nullptr) _handler->cdataDecl(_out, text);
+    buffer += static_cast<char>(0xE0 | (value >> 12));
+    buffer += static_cast<char>(0x80 | ((value >> 6) & 0x3F));
+    buffer += static_cast<char>(0x80 | (value & 0x3F));
   }
   else
   {
-    if ((result = matchString("DOCTYPE", in, i, _out, j)) != OK) return result;
-
-    if ((result = matchChar(" \t\n\r", in, i, _out, j)) != OK) return result;
-
-    std::string dummy;
-
-    if ((result = skipTillChar("[>", in, i, _out, j, dummy)) != OK) return result;
-
-    if ((result = matchChar("[", in, i, _out, j)) == MORE) return result;
-
-    if (result == OK)
-    {
-      if ((result = skipTillChar("]", in, i, _out, j, dummy)) != OK) return result;
-
-      if ((result = matchChar("]", in, i, _out, j)) != OK) return result;
-    }
-
-    if ((result = skipTillChar(">", in, i, _out, j, dummy)) != OK) return result;
-
-    if ((result = matchChar(">", in, i, _out, j)) != OK) return result;
-
-    if (_handler != nullptr) _handler->docTypeDecl(_out);
+    buffer += static_cast<char>(0xF0 | (value >> 18));
+    buffer += static_cast<char>(0x80 | ((value >> 12) & 0x3F));
+    buffer += static_cast<char>(0x80 | ((value >> 6) & 0x3F));
+    buffer += static_cast<char>(0x80 | (value & 0x3F));
   }
-  setState(TEXT);
 
-  return OK;
+  return true;
 }
 
-XMLParser::Result XMLParser::parseAttribute(const std::string &pattern,
-                                            const std::string &in,  std::string::size_type &i,
-                                                  std::string &out, std::string::size_type &j,
-                                                  std::string &key, std::string &value)
+// Adapter from the view handler to the string handler; the strings are
+// reused for every event, so in steady state nothing is allocated
+const XMLParserHandler::Attributes &XMLParser::HandlerAdapter::convert(const Attributes &attributes)
 {
-  Result result;
-
-  key.clear();
-
-  if ((result = skipTillChar(pattern, in, i, out, j, key)) != OK) return result;
-
-  if (key.empty()) return OK;
+  _attributes.clear();
 
-  if ((result = matchChars(" \t\r\n", in, i, out, j)) == MORE) return result;
-
-  if ((result = matchChar("=", in, i, out, j)) != OK) return result;
-
-  if ((result = matchChars(" \t\r\n", in, i, out, j)) == MORE) return result;
-
-  if ((result = matchChar("\"", in, i, out, j)) == MORE) return result;
-
-  value.clear();
-
-  if (result == OK)
+  for (auto iter = attributes.begin(); iter != attributes.end(); ++iter)
   {
-    if ((result = skipTillChar("\">", in, i, out, j, value)) != OK) return result;
-
-    if ((result = matchChar(">", in, i, out, j)) == OK) return FAIL;
-
-    if ((result = matchChar("\"", in, i, out, j)) != OK) return result;
-  }
-  else
-  {
-    if ((result = matchChar("'", in, i, out, j)) != OK) return result;
-
-    if ((result = skipTillChar("'>", in, i, out, j, value)) != OK) return result;
-
-    if ((result = matchChar(">", in, i, out, j)) == OK) return FAIL;
-
-    if ((result = matchChar("'", in, i, out, j)) != OK) return result;
+    _attributes.insert(iter->first, iter->second);
   }
 
-  if ((result = matchChars(" \t\r\n", in, i, out, j)) == MORE) return result;
-
-  return OK;
+  return _attributes;
 }
 
-XMLParser::Result XMLParser::parseElement(const std::string &in, std::string::size_type &i)
+void XMLParser::HandlerAdapter::xmlDecl(std::string_view text, const Attributes &attributes)
 {
-  std::string::size_type j = 1;
-
-  bool startTag = false;
-  bool endTag   = false;
-
-  Result result;
-
-  XMLParserHandler::Attributes attributes;
-
-  if ((result = matchChar("/", in, i, _out, j)) == MORE) return result;
-
-  if (result == OK) endTag = true; else startTag = true;
-
-  std::string name;
-  std::string key;
-  std::string value;
-
-  name.clear();
-
-  if ((result = skipTillChar(" \t\n\r/>", in, i, _out, j, name)) != OK) return result;
-
-  if (name.empty()) return FAIL;
-
-  if ((result = matchChars(" \t\r\n", in, i, _out, j)) == MORE) return result;
-
-  while (startTag)
-  {
-    if ((result = parseAttribute(" \t\n\r=/>", in, i, _out, j, key, value)) != OK) return result;
-
-    if (key.empty()) break;
-
-    attributes.insert(std::make_pair(key, value));
-  }
-
-  if ((result = matchChar("/", in, i, _out, j)) == MORE) return result;
-
-  if (result == OK)
-  {
-    if (endTag) return FAIL;
-
-    endTag = true;
-  }
-
-  if ((result = matchChar(">", in, i, _out, j)) != OK) return result;
-
-  if (_handler != nullptr)
-  {
-    if (startTag && endTag)
-    {
-      _handler->startEndElement(_out, name, attributes);
-    }
-    else if (startTag)
-    {
-      _handler->startElement(_out, name, attributes);
-    }
-    else if (endTag)
-    {
-      _handler->endElement(_out, name);
-    }
-
-    setState(TEXT);
-  }
-
-  return OK;
+  _handler->xmlDecl(_text.assign(text), convert(attributes));
 }
 
-// Helpers
-bool XMLParser::isInChars(char ch, const std::string &chars)
+void XMLParser::HandlerAdapter::processingInstruction(std::string_view text, std::string_view target, std::string_view value)
 {
-  for (std::string::size_type k = 0; k < chars.size(); k++)
-  {
-    if (ch == chars[k]) return true;
-  }
-
-  return false;
+  _handler->processingInstruction(_text.assign(text), _name.assign(target), _value.assign(value));
 }
 
-XMLParser::Result XMLParser::matchChar(const std::string &chars,
-                                       const std::string &in,  std::string::size_type &i,
-                                             std::string &out, std::string::size_type &j)
+void XMLParser::HandlerAdapter::docTypeDecl(std::string_view text)
 {
-  char ch;
-
-  if ((ch = hasChar(in, i, out, j)) == '\0') return MORE;
-
-  if (!isInChars(ch, chars)) return FAIL;
-
-  j++;
-
-  return OK;
+  _handler->docTypeDecl(_text.assign(text));
 }
 
-XMLParser::Result XMLParser::matchNotChar(const std::string &chars,
-                                          const std::string &in,  std::string::size_type &i,
-                                                std::string &out, std::string::size_type &j)
+void XMLParser::HandlerAdapter::comment(std::string_view text, std::string_view comment)
 {
-  char ch;
-
-  if ((ch = hasChar(in, i, out, j)) == '\0') return MORE;
-
-  if (isInChars(ch, chars)) return FAIL;
-
-  j++;
-
-  return OK;
+  _handler->comment(_text.assign(text), _value.assign(comment));
 }
 
-XMLParser::Result XMLParser::matchString(const std::string &pattern,
-                                         const std::string &in,  std::string::size_type &i,
-                                               std::string &out, std::string::size_type &j)
+void XMLParser::HandlerAdapter::startElement(std::string_view text, std::string_view name, const Attributes &attributes)
 {
-  for (std::string::size_type k = 0; k < pattern.size(); k++)
-  {
-    char ch;
-
-    if ((ch = hasChar(in, i, out, j + k)) == '\0') return MORE;
-
-    if (ch != pattern[k]) return FAIL;
-  }
-
-  j += pattern.size();
-
-  return OK;
+  _handler->startElement(_text.assign(text), _name.assign(name), convert(attributes));
 }
 
-XMLParser::Result XMLParser::matchChars(const std::string &chars,
-                                        const std::string &in,  std::string::size_type &i,
-                                              std::string &out, std::string::size_type &j)
+void XMLParser::HandlerAdapter::endElement(std::string_view text, std::string_view name)
 {
-  std::string::size_type k = j;
-
-  Result result;
-
-  while ((result = matchChar(chars, in, i, out, j)) == OK)
-  {
-  }
-
-  if (result == FAIL && j > k) result = OK;
-
-  return result;
+  _handler->endElement(_text.assign(text), _name.assign(name));
 }
 
-XMLParser::Result XMLParser::matchNotChars(const std::string &chars,
-                                           const std::string &in,  std::string::size_type &i,
-                                                 std::string &out, std::string::size_type &j)
+void XMLParser::HandlerAdapter::startEndElement(std::string_view text, std::string_view name, const Attributes &attributes)
 {
-  std::string::size_type k = j;
-
-  Result result;
-
-  while ((result = matchNotChar(chars, in, i, out, j)) == OK)
-  {
-  }
-
-  if (result == FAIL && j > k) result = OK;
-
-  return result;
+  _handler->startEndElement(_text.assign(text), _name.assign(name), convert(attributes));
 }
 
-
-// Pattern is processed !
-XMLParser::Result XMLParser::skipTillString(const std::string &pattern,
-                                            const std::string &in,  std::string::size_type &i,
-                                                  std::string &out, std::string::size_type &j,
-                                                  std::string &text)
+void XMLParser::HandlerAdapter::text(std::string_view text)
 {
-  Result result = FAIL;
-
-  while ((result = matchString(pattern, in, i, out, j)) == FAIL)
-  {
-    text.push_back(out[j++]);
-  }
-
-  return result;
+  _handler->text(_text.assign(text));
 }
 
-// Till char is not processed !
-XMLParser::Result XMLParser::skipTillChar(const std::string &chars,
-                                          const std::string &in,  std::string::size_type &i,
-                                                std::string &out, std::string::size_type &j,
-                                                std::string &text)
+void XMLParser::HandlerAdapter::cdataDecl(std::string_view text, std::string_view data)
 {
-  Result result;
-
-  while ((result = matchChar(chars, in, i, out, j)) == FAIL)
-  {
-    text.push_back(out[j++]);
-  }
-
-  if (result == OK) j--;
-
-  return result;
+  _handler->cdataDecl(_text.assign(text), _value.assign(data));
 }
 
-// Till char is not processed !
-XMLParser::Result XMLParser::skipTillNotChar(const std::string &chars,
-                                             const std::string &in,  std::string::size_type &i,
-                                                   std::string &out, std::string::size_type &j,
-                                                   std::string &text)
+void XMLParser::HandlerAdapter::unhandled(std::string_view text, int lineNumber, int columnNumber)
 {
-  Result result = FAIL;
-
-  while ((result = matchNotChar(chars, in, i, out, j)) == FAIL)
-  {
-    text.push_back(out[j++]);
-  }
-
-  if (result == OK) j--;
+  _handler->unhandled(_text.assign(text), lineNumber, columnNumber);
+}
 
-  return result;
+void XMLParser::HandlerAdapter::skipped(std::string_view text)
+{
+  _handler->skipped(_text.assign(text));
 }
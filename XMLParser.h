@@ -24,8 +24,9 @@
 //==============================================================================
 
 #include <string>
-#include <iostream>
-#include <map>
+#include <string_view>
+
+#include "BasicXMLParser.h"
 
 ///
 /// @class XMLParserHandler
@@ -38,7 +39,7 @@ public:
   XMLParserHandler() {}
   virtual ~XMLParserHandler() {}
 
-  typedef std::map<std::string, std::string> Attributes;
+  typedef XMLAttributeList<std::string> Attributes;
 
   virtual void xmlDecl(const std::string &text, const Attributes &attributes) = 0;
   virtual void processingInstruction(const std::string &text, const std::string &target, const std::string &value) = 0;
@@ -50,14 +51,44 @@ public:
   virtual void text(const std::string &text) = 0;
   virtual void cdataDecl(const std::string &text, const std::string &data) = 0;
   virtual void unhandled(const std::string &text, int lineNumber, int columnNumber) = 0;
+  virtual void skipped(const std::string &) {}
+};
+
+///
+/// @class XMLParserViewHandler
+///
+/// @brief The xml parser handler class that receives views in the parser
+///        buffer; the views are only valid during the callback.
+///
+class XMLParserViewHandler
+{
+public:
+  XMLParserViewHandler() {}
+  virtual ~XMLParserViewHandler() {}
+
+  typedef XMLAttributeList<std::string_view> Attributes;
+
+  virtual void xmlDecl(std::string_view text, const Attributes &attributes) = 0;
+  virtual void processingInstruction(std::string_view text, std::string_view target, std::string_view value) = 0;
+  virtual void docTypeDecl(std::string_view text) = 0;
+  virtual void comment(std::string_view text, std::string_view comment) = 0;
+  virtual void startElement(std::string_view text, std::string_view name, const Attributes &attributes) = 0;
+  virtual void endElement(std::string_view text, std::string_view name) = 0;
+  virtual void startEndElement(std::string_view text, std::string_view name, const Attributes &attributes) = 0;
+  virtual void text(std::string_view text) = 0;
+  virtual void cdataDecl(std::string_view text, std::string_view data) = 0;
+  virtual void unhandled(std::string_view text, int lineNumber, int columnNumber) = 0;
+  virtual void skipped(std::string_view) {}
+  virtual void point(std::string_view, const XMLPoint &) {}   // only for the elements in XMLParserFilter::setPointsFor
+  virtual void pointBatch(const XMLPointBatch &) {}           // only with XMLParserFilter::setPointBatchSize
 };
 
 ///
 /// @class XMLParser
 ///
-/// @brief The xml parser class.
+/// @brief The xml parser class, calling the virtual callbacks of a handler.
 ///
-class XMLParser
+class XMLParser : public BasicXMLParser<XMLParserViewHandler>
 {
 public:
 
@@ -73,6 +104,13 @@ public:
   ///
   XMLParser(XMLParserHandler *handler);
 
+  ///
+  /// Constructor
+  ///
+  /// @param handler     the XMLParser view handler
+  ///
+  XMLParser(XMLParserViewHandler *handler);
+
   ///
   /// Deconstructor
   ///
@@ -85,73 +123,32 @@ public:
   ///
   /// @param handler     the XMLParser handler
   ///
-  void setHandler(XMLParserHandler *handler) { _handler = handler; }
+  void setHandler(XMLParserHandler *handler);
 
   ///
-  /// Get the current line number
+  /// Set the XMLParser view handler
   ///
-  /// @return the current line number
+  /// @param handler     the XMLParser view handler
   ///
-  int lineNumber() const { return _lineNumber; }
+  void setHandler(XMLParserViewHandler *handler) { BasicXMLParser<XMLParserViewHandler>::setHandler(handler); }
 
   ///
-  /// Get the current column number
-  ///
-  /// @return the current column number
-  ///
-  int columnNumber() const { return _columnNumber; }
-
-  // Parsing methods
-
-  ///
-  /// Parse data
-  ///
-  /// @param  data    the data to be parsed
-  /// @param  length  the length of the data
-  /// @param  isFinal is this the last data ?
-  ///
-  /// @return success
-  ///
-  bool parse(const char *data, size_t length, bool isFinal);
-
-  ///
-  /// Parse text
-  ///
-  /// @param  text    the zero terminated text to be parsed
-  /// @param  isFinal is this the last data ?
-  ///
-  /// @return success
-  ///
-  bool parse(const char *text, bool isFinal);
-
-  ///
-  /// Parse string
-  ///
-  /// @param  data    the data to be parsed
-  /// @param  isFinal is this the last data ?
-  ///
-  /// @return success
-  ///
-  bool parse(const std::string &data, bool isFinal);
-
-  ///
-  /// Parse an input stream
+  /// Trim the text from whitespace
   ///
-  /// @param  stream        the stream to be parsed
+  /// @param  text         the text
   ///
-  /// @return success
+  /// @return the text without whitespace
   ///
-  bool parse(std::istream &stream);
-
+  static std::string trim(const std::string &text);
 
   ///
-  /// Trim the text from whitespace
+  /// Trim the text view from whitespace
   ///
   /// @param  text         the text
   ///
-  /// @return the text without whitespace
+  /// @return the view without whitespace
   ///
-  static std::string trim(const std::string &text);
+  static std::string_view trim(std::string_view text);
 
   ///
   /// Translate an entity reference in the text
@@ -163,7 +160,8 @@ public:
   static void translateEntityRef(std::string &text, const std::string &pattern, const std::string &replace);
 
   ///
-  /// Translate the entity references: &lt; &gt; &apos; &quot; &amp;
+  /// Translate the entity references: &lt; &gt; &apos; &quot; &amp; and the
+  /// numeric references
   ///
   /// @param text          the text
   ///
@@ -171,83 +169,53 @@ public:
   ///
   static std::string translateEntityRefs(const std::string &text);
 
+  ///
+  /// Decode the entity references in one pass: &lt; &gt; &apos; &quot; &amp;
+  /// and the numeric references &#NNN; and &#xHH; (as UTF-8). Unknown or
+  /// invalid references are kept.
+  ///
+  /// @param text          the text
+  /// @param buffer        the buffer for the decoded text
+  ///
+  /// @return the text itself if there are no references, else the buffer
+  ///
+  static std::string_view decodeEntityRefs(std::string_view text, std::string &buffer);
+
 private:
-  // Types
-  enum State
-  {
-    TEXT,
-    MARKUP,
-    COMMENT,
-    PI,
-    ELEMENT
-  };
-  void setState(State state);
+  static bool decodeEntityRef(std::string_view name, std::string &buffer);
 
-  enum Result
+  // Adapter from the view handler to the string handler
+  class HandlerAdapter : public XMLParserViewHandler
   {
-    ERROR,
-    MORE,
-    OK,
-    FAIL
+  public:
+    HandlerAdapter() : _handler(nullptr) {}
+
+    void setHandler(XMLParserHandler *handler) { _handler = handler; }
+
+    virtual void xmlDecl(std::string_view text, const Attributes &attributes);
+    virtual void processingInstruction(std::string_view text, std::string_view target, std::string_view value);
+    virtual void docTypeDecl(std::string_view text);
+    virtual void comment(std::string_view text, std::string_view comment);
+    virtual void startElement(std::string_view text, std::string_view name, const Attributes &attributes);
+    virtual void endElement(std::string_view text, std::string_view name);
+    virtual void startEndElement(std::string_view text, std::string_view name, const Attributes &attributes);
+    virtual void text(std::string_view text);
+    virtual void cdataDecl(std::string_view text, std::string_view data);
+    virtual void unhandled(std::string_view text, int lineNumber, int columnNumber);
+    virtual void skipped(std::string_view text);
+
+  private:
+    const XMLParserHandler::Attributes &convert(const Attributes &attributes);
+
+    XMLParserHandler            *_handler;
+    XMLParserHandler::Attributes _attributes;
+    std::string                  _text;
+    std::string                  _name;
+    std::string                  _value;
   };
 
-  // String parsing
-
-  char hasChar(const std::string &in, std::string::size_type &i);
-
-  char hasChar(const std::string &in, std::string::size_type &i, std::string &out, std::string::size_type j);
-
-  static bool isInChars(char ch, const std::string &chars);
-
-  // XML Parsing
-  Result parseText(const std::string &in, std::string::size_type &i);
-  Result parseMarkup(const std::string &in, std::string::size_type &i);
-
-  Result parseDeclaration(const std::string &in, std::string::size_type &i);
-  Result parseSection(const std::string &in, std::string::size_type &i);
-  Result parseElement(const std::string &in, std::string::size_type &i);
-  Result parseAttribute(const std::string &pattern,
-                        const std::string &in,  std::string::size_type &i,
-                              std::string &out, std::string::size_type &j,
-                              std::string &key, std::string &value);
-  Result doUnhandled();
-
-  Result matchChar(const std::string &chars,
-                   const std::string &in, std::string::size_type &i,
-                         std::string &out, std::string::size_type &j);
-  Result matchNotChar(const std::string &chars,
-                      const std::string &in, std::string::size_type &i,
-                            std::string &out, std::string::size_type &j);
-  Result matchString(const std::string &pattern,
-                     const std::string &in, std::string::size_type &i,
-                           std::string &out, std::string::size_type &j);
-  Result matchChars(const std::string &chars,
-                    const std::string &in, std::string::size_type &i,
-                    std::string &out, std::string::size_type &j);
-  Result matchNotChars(const std::string &chars,
-                       const std::string &in, std::string::size_type &i,
-                       std::string &out, std::string::size_type &j);
-  Result skipTillString(const std::string &pattern,
-                         const std::string &in, std::string::size_type &i,
-                               std::string &out, std::string::size_type &j,
-                               std::string &text);
-  Result skipTillNotChar(const std::string &chars,
-                          const std::string &in, std::string::size_type &i,
-                                std::string &out, std::string::size_type &j,
-                                std::string &text);
-  Result skipTillChar(const std::string &chars,
-                       const std::string &in, std::string::size_type &i,
-                             std::string &out, std::string::size_type &j,
-                             std::string &text);
-
   // Members
-  XMLParserHandler *_handler;
-
-  State             _state;
-  std::string       _out;
-
-  int               _lineNumber;
-  int               _columnNumber;
+  HandlerAdapter        _adapter;
 
   // Disable copy constructors
   XMLParser(const XMLParser &);
@@ -255,5 +223,7 @@ private:
 
 };
 
+extern template class BasicXMLParser<XMLParserViewHandler>;
+
 #endif
 
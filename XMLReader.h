@@ -0,0 +1,322 @@
+#ifndef XMLREADER_H
+#define XMLREADER_H
+
+//==============================================================================
+//
+//                 XMLReader - the pull xml reader class
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//==============================================================================
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "BasicXMLParser.h"
+#include "XMLInput.h"
+
+///
+/// @class XMLEvent
+///
+/// @brief An event of the XMLReader. The views are valid till the next event.
+///
+struct XMLEvent
+{
+  typedef XMLAttributeList<std::string_view> Attributes;
+
+  XMLParserFilter::Event _type;
+  std::string_view       _text;         // the text of the event
+  std::string_view       _name;         // the element name or the processing instruction target
+  std::string_view       _value;        // the comment, the cdata or the processing instruction value
+  const Attributes      *_attributes;   // the attributes of the xml declaration and the elements
+  std::uint64_t          _offset;       // the byte offset of the text in the document
+  int                    _lineNumber;   // the position of an unhandled event
+  int                    _columnNumber;
+};
+
+///
+/// @class XMLReader
+///
+/// @brief The pull xml reader class: next() parses till the next event and
+///        returns it. The events are views in the input, without callbacks.
+///
+class XMLReader
+{
+public:
+  typedef XMLEvent::Attributes Attributes;
+
+  ///
+  /// Constructor
+  ///
+  /// @param input       the opened input (read by the reader)
+  ///
+  XMLReader(XMLInput &input) :
+    _handler(this),
+    _parser(&_handler),
+    _input(&input),
+    _data(nullptr),
+    _length(0),
+    _unread(false),
+    _final(false),
+    _error(false),
+    _ready(false)
+  {
+  }
+
+  ///
+  /// Constructor
+  ///
+  /// @param data        the complete document (valid during the reading)
+  /// @param length      the length of the document
+  ///
+  XMLReader(const char *data, size_t length) :
+    _handler(this),
+    _parser(&_handler),
+    _input(nullptr),
+    _data(data),
+    _length(length),
+    _unread(true),
+    _final(false),
+    _error(false),
+    _ready(false)
+  {
+  }
+
+  ///
+  /// Set the filter for the events, before the first event
+  ///
+  /// @param filter      the filter
+  ///
+  void setFilter(const XMLParserFilter &filter) { _parser.setFilter(filter); }
+
+  ///
+  /// Read the next event
+  ///
+  /// @return the event (valid till the next call) or nullptr at the end
+  ///
+  const XMLEvent *next();
+
+  ///
+  /// Is the end of the document reached without errors ?
+  ///
+  /// @return is it
+  ///
+  bool isEof() const { return _final && !_error && !_parser.isSuspended() && (_input == nullptr || _input->isEof()); }
+
+private:
+  // The handler that stores the event and suspends the parser
+  class Handler : public BasicXMLParserHandler
+  {
+  public:
+    Handler(XMLReader *reader) : _reader(reader) {}
+
+    void xmlDecl(std::string_view text, const Attributes &attributes)
+    {
+      _reader->set(XMLParserFilter::XML_DECL, text, std::string_view(), std::string_view(), &attributes);
+    }
+
+    void processingInstruction(std::string_view text, std::string_view target, std::string_view value)
+    {
+      _reader->set(XMLParserFilter::PROCESSING_INSTRUCTION, text, target, value);
+    }
+
+    void docTypeDecl(std::string_view text)
+    {
+      _reader->set(XMLParserFilter::DOCTYPE_DECL, text);
+    }
+
+    void comment(std::string_view text, std::string_view comment)
+    {
+      _reader->set(XMLParserFilter::COMMENT, text, std::string_view(), comment);
+    }
+
+    void startElement(std::string_view text, std::string_view name, const Attributes &attributes)
+    {
+      _reader->set(XMLParserFilter::START_ELEMENT, text, name, std::string_view(), &attributes);
+    }
+
+    void endElement(std::string_view text, std::string_view name)
+    {
+      _reader->set(XMLParserFilter::END_ELEMENT, text, name);
+    }
+
+    void startEndElement(std::string_view text, std::string_view name, const Attributes &attributes)
+    {
+      _reader->set(XMLParserFilter::START_END_ELEMENT, text, name, std::string_view(), &attributes);
+    }
+
+    void text(std::string_view text)
+    {
+      _reader->set(XMLParserFilter::TEXT, text);
+    }
+
+    void cdataDecl(std::string_view text, std::string_view data)
+    {
+      _reader->set(XMLParserFilter::CDATA_DECL, text, std::string_view(), data);
+    }
+
+    void unhandled(std::string_view text, int lineNumber, int columnNumber)
+    {
+      _reader->set(XMLParserFilter::UNHANDLED, text);
+
+      _reader->_event._lineNumber   = lineNumber;
+      _reader->_event._columnNumber = columnNumber;
+    }
+
+    void skipped(std::string_view text)
+    {
+      _reader->set(XMLParserFilter::SKIPPED, text);
+    }
+
+  private:
+    XMLReader *_reader;
+  };
+
+  void set(XMLParserFilter::Event type, std::string_view text,
+           std::string_view name = std::string_view(), std::string_view value = std::string_view(),
+           const Attributes *attributes = nullptr);
+
+  bool read();
+
+  // Members
+  Handler                  _handler;
+  BasicXMLParser<Handler>  _parser;
+
+  XMLInput                *_input;
+  const char              *_data;
+  size_t                   _length;
+  bool                     _unread;
+  bool                     _final;
+  bool                     _error;
+
+  XMLEvent                 _event;
+  bool                     _ready;
+
+  std::string              _copy;
+  Attributes               _attributes;
+
+  // Disable copy constructors
+  XMLReader(const XMLReader &);
+  XMLReader& operator=(const XMLReader &);
+};
+
+// -- Implementation ----------------------------------------------------------
+
+inline const XMLEvent *XMLReader::next()
+{
+  _ready = false;
+
+  while (!_ready)
+  {
+    bool result;
+
+    if (_parser.isSuspended())
+    {
+      result = _parser.resume();
+    }
+    else if (_final)
+    {
+      return nullptr;
+    }
+    else if (read())
+    {
+      result = _parser.parse(_data, _length, false);
+    }
+    else
+    {
+      _final  = true;
+      _data   = "";
+      _length = 0;
+
+      result = _parser.parse(_data, _length, true);
+    }
+
+    if (!result)
+    {
+      _final = true;
+      _error = true;
+
+      return nullptr;
+    }
+  }
+
+  return &_event;
+}
+
+// The next block of the input; a document in memory is one block
+inline bool XMLReader::read()
+{
+  if (_input != nullptr) return _input->read(_data, _length);
+
+  if (!_unread) return false;
+
+  _unread = false;
+
+  return true;
+}
+
+// Store the event; the views in the carry-over buffer of the parser are copied,
+// because the parser reuses the buffer before the reader is resumed
+inline void XMLReader::set(XMLParserFilter::Event type, std::string_view text, std::string_view name, std::string_view value, const Attributes *attributes)
+{
+  if (text.data() < _data || text.data() + text.size() > _data + _length)
+  {
+    const char *from = text.data();
+
+    _copy.assign(text);
+
+    auto rebase = [&](std::string_view view) { return view.empty() ? view : std::string_view(_copy.data() + (view.data() - from), view.size()); };
+
+    text  = rebase(text);
+    name  = rebase(name);
+    value = rebase(value);
+
+    if (attributes != nullptr && attributes->raw().data() != nullptr)
+    {
+      _attributes.assign(rebase(attributes->raw()));
+
+      attributes = &_attributes;
+    }
+    else if (attributes != nullptr)
+    {
+      _attributes.clear();
+
+      for (auto iter = attributes->begin(); iter != attributes->end(); ++iter)
+      {
+        _attributes.insert(rebase(iter->first), rebase(iter->second));
+      }
+
+      attributes = &_attributes;
+    }
+  }
+
+  _event._type         = type;
+  _event._text         = text;
+  _event._name         = name;
+  _event._value        = value;
+  _event._attributes   = attributes;
+  _event._offset       = _parser.offset();
+  _event._lineNumber   = 0;
+  _event._columnNumber = 0;
+
+  _ready = true;
+
+  _parser.suspend();
+}
+
+#endif
@@ -0,0 +1,160 @@
+// ==============================================================================
+//
+//          gpxpoints - the example of the pull readers
+//
+//               Copyright (C) 2017  Dick van Oudheusden
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 3 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this library; if not, write to the Free
+// Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// ==============================================================================
+
+#include <iostream>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <unistd.h>
+
+#include "XMLInput.h"
+#include "XMLReader.h"
+#include "GpxPointReader.h"
+
+// List the points in a gpx file with GpxPointReader, or count the events with
+// XMLReader. A memory mapped file is read as one buffer, other input (stdin,
+// pipes, compressed files) through the XMLInput.
+
+static void report(double value)
+{
+  if (value == std::numeric_limits<double>::min())
+  {
+    std::cout << '-';
+  }
+  else
+  {
+    std::cout << value;
+  }
+}
+
+static bool listPoints(XMLInput &input)
+{
+  std::unique_ptr<GpxPointReader> reader;
+
+  if (input.isMapped())
+  {
+    reader.reset(new GpxPointReader(input.mapped(), input.mappedSize()));
+  }
+  else
+  {
+    reader.reset(new GpxPointReader(input));
+  }
+
+  const GpxPoint *point;
+
+  while ((point = reader->next()) != nullptr)
+  {
+    std::cout << (point->_type == GpxPath::WPT ? "wpt" : (point->_type == GpxPath::RTEPT ? "rtept" : "trkpt")) << ' ' << point->_segment << ' ';
+    report(point->_lat);
+    std::cout << ' ';
+    report(point->_lon);
+    std::cout << ' ';
+    report(point->_ele);
+    std::cout << ' ' << (point->_time.empty() ? "-" : point->_time) << '\n';
+  }
+
+  return reader->isEof();
+}
+
+static bool countEvents(XMLInput &input)
+{
+  std::unique_ptr<XMLReader> reader;
+
+  if (input.isMapped())
+  {
+    reader.reset(new XMLReader(input.mapped(), input.mappedSize()));
+  }
+  else
+  {
+    reader.reset(new XMLReader(input));
+  }
+
+  unsigned long elements = 0;
+  unsigned long events   = 0;
+
+  const XMLEvent *event;
+
+  while ((event = reader->next()) != nullptr)
+  {
+    if (event->_type == XMLParserFilter::UNHANDLED) return false;
+
+    if (event->_type == XMLParserFilter::START_ELEMENT || event->_type == XMLParserFilter::START_END_ELEMENT) elements++;
+
+    events++;
+  }
+
+  std::cout << "Events: " << events << " Elements: " << elements << '\n';
+
+  return reader->isEof();
+}
+
+int main(int argc, char *argv[])
+{
+  bool        events = false;
+  std::string filename;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-?") == 0)
+    {
+      std::cout << "Usage: gpxpoints [-h] [-e] [<file.gpx>]" << std::endl;
+      std::cout << "  -h           help" << std::endl;
+      std::cout << "  -e           count the events" << std::endl;
+      std::cout << " file.gpx      the input gpx file" << std::endl << std::endl;
+      std::cout << "   List the points in a gpx file." << std::endl;
+      return 0;
+    }
+    else if (strcmp(argv[i], "-e") == 0)
+    {
+      events = true;
+    }
+    else if (argv[i][0] != '-' && filename.empty())
+    {
+      filename = argv[i];
+    }
+    else
+    {
+      std::cerr << "Error: unknown option:" << argv[i] << std::endl;
+      return 1;
+    }
+  }
+
+  XMLInput input;
+
+  if (filename.empty() ? !input.open(STDIN_FILENO) : !input.open(filename))
+  {
+    std::cerr << "Error: unable to open: " << filename << std::endl;
+    return 1;
+  }
+
+  bool done = (events ? countEvents(input) : listPoints(input));
+
+  input.close();
+
+  if (!done)
+  {
+    std::cerr << "Error: invalid gpx input" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,19 +1,23 @@
 #include <iostream>
 #include <cstring>
-#include <fstream>
 #include <list>
 #include <cmath>
 #include <limits>
 #include <iomanip>
+#include <unistd.h>
 
 #include "XMLParser.h"
+#include "XMLInput.h"
+#include "XMLOutput.h"
+#include "XMLNumber.h"
+#include "GpxPath.h"
 
 const std::string tool   = "gpxcat";
 const std::string version= "0.1.0";
 
 // ----------------------------------------------------------------------------
 
-class GpxCat : public XMLParserHandler
+class GpxCat : public XMLParserViewHandler
 {
 public:
   // -- Constructor -----------------------------------------------------------
@@ -21,6 +25,7 @@ public:
     _distance(-1.0),
     _doConcat(false)
   {
+    _output.open(STDOUT_FILENO);
   }
 
   // -- Deconstructor ---------------------------------------------------------
@@ -35,49 +40,52 @@ public:
   // -- Process a file ----------------------------------------------------------
   void processFile(const std::string &inputFilename)
   {
-    std::ifstream stream(inputFilename.c_str());
+    XMLInput input;
 
-    if (stream.is_open())
+    if (input.open(inputFilename))
     {
-      parseFile(stream);
+      parseFile(input);
 
-      stream.close();
+      input.close();
     }
   }
 
-  static bool getDoubleAttribute(const Attributes &atts, const std::string &key, double &value)
+  static bool getDoubleAttribute(const Attributes &atts, std::string_view key, double &value)
   {
-    auto iter = atts.find(key);
-
-    if (iter == atts.end()) return false;
-
-    return getDouble(iter->second, value);
+    return atts.getDouble(key, value);
   }
 
-  static bool getDouble(const std::string &str, double &value)
+  static bool getDouble(std::string_view str, double &value)
   {
-    try
-    {
-      value = std::stod(str);
-
-      return true;
-    }
-    catch (...)
-    {
-      return false;
-    }
+    return XMLNumber::toDouble(str, value);
   }
 
 private:
   // -- Parse a file ----------------------------------------------------------
-  bool parseFile(std::istream &input)
+  bool parseFile(XMLInput &input)
   {
     _path.clear();
 
+    // The held text is a range in the previous input
+    _doConcat = false;
+    _current.clear();
+
+    // The unchanged text is copied from the input
+    _output.setInput(&input);
+
+    // The simple track points are passed as one event
+    XMLParserFilter filter;
+
+    filter.setPointsFor({ "trkpt" });
+
     XMLParser parser(this);
 
+    parser.setFilter(filter);
+
     parser.parse(input);
 
+    _output.setInput(nullptr);
+
     return true;
   }
 
@@ -112,101 +120,108 @@ private:
     return c * R;
   }
 
-  void store(const std::string &text)
+  void store(std::string_view text)
   {
     if (_doConcat)
     {
-      _current.append(text);
+      _output.append(_current, text);
     }
     else
     {
-      std::cout << text;
+      _output.write(text);
     }
   }
 
-  void doStartElement(const std::string &name, const Attributes &attributes)
+  void doStartElement(std::string_view name, const Attributes &attributes)
   {
-    _path.append("/");
-    _path.append(name);
-
-    if (_path == "/gpx/trk/trkseg/trkpt")
+    if (_path.push(name) == GpxPath::TRKPT)
     {
       double lat, lon = 0.0;
 
       if (getDoubleAttribute(attributes, "lat", lat) && getDoubleAttribute(attributes, "lon", lon))
       {
-        if (_doConcat)
-        {
-          if (_distance >= 0.0 && calcDistance(_lastLat, _lastLon, lat, lon) > _distance)
-          {
-            std::cout << _current;
-          }
-
-          _doConcat = false;
-        }
-
-        _lastLat = lat;
-        _lastLon = lon;
+        doTrackPoint(lat, lon);
       }
     }
   }
 
-  void doEndElement()
+  void doTrackPoint(double lat, double lon)
   {
-    if (_path == "/gpx/trk")
+    if (_doConcat)
     {
-      if (_doConcat)
+      if (_distance >= 0.0 && calcDistance(_lastLat, _lastLon, lat, lon) > _distance)
       {
-        std::cout << _current;
-
-        _doConcat = false;
+        _output.write(_current);
       }
+
+      _doConcat = false;
     }
-    else if (_path == "/gpx/trk/trkseg")
+
+    _lastLat = lat;
+    _lastLon = lon;
+  }
+
+  void doEndElement()
+  {
+    switch (_path.state())
     {
-      _doConcat = true;
-      _current.clear();
-    }
+      case GpxPath::TRK:
+        if (_doConcat)
+        {
+          _output.write(_current);
+
+          _doConcat = false;
+        }
+        break;
+
+      case GpxPath::TRKSEG:
+        _doConcat = true;
+        _current.clear();
+        break;
 
-    size_t i =  _path.find_last_of('/');
+      default:
+        break;
+    }
 
-    if (i != std::string::npos) _path.erase(i);
+    _path.pop();
   }
 
 public:
   // -- Callbacks -------------------------------------------------------------
-  virtual void xmlDecl(const std::string &text, const Attributes &)
+  virtual void xmlDecl(std::string_view text, const Attributes &)
   {
     store(text);
   }
 
-  virtual void processingInstruction(const std::string &text, const std::string &, const std::string &)
+  virtual void processingInstruction(std::string_view text, std::string_view, std::string_view)
   {
     store(text);
   }
 
-  virtual void docTypeDecl(const std::string &text)
+  virtual void docTypeDecl(std::string_view text)
   {
     store(text);
   }
 
-  virtual void unhandled(const std::string &text, int lineNumber, int columnNumber)
+  virtual void unhandled(std::string_view text, int lineNumber, int columnNumber)
   {
+    _output.close();
+
     std::cerr << "  ERROR: Unexpected gpx info: " << text <<  " on line: " << lineNumber << " columnNumber: " << columnNumber << std::endl;
     exit(1);
   }
 
-  virtual void cdataDecl(const std::string &text, const std::string &)
+  virtual void cdataDecl(std::string_view text, std::string_view)
   {
     store(text);
   }
 
-  virtual void comment(const std::string &text, const std::string &)
+  virtual void comment(std::string_view text, std::string_view)
   {
     store(text);
   }
 
-  virtual void startEndElement(const std::string &text, const std::string &name, const Attributes &attributes)
+  virtual void startEndElement(std::string_view text, std::string_view name, const Attributes &attributes)
   {
     doStartElement(name, attributes);
 
@@ -215,20 +230,34 @@ public:
     store(text);
   }
 
-  virtual void startElement(const std::string &text, const std::string &name, const Attributes &attributes)
+  virtual void startElement(std::string_view text, std::string_view name, const Attributes &attributes)
   {
     doStartElement(name, attributes);
 
     store(text);
   }
 
-  virtual void text(const std::string &text)
+  virtual void text(std::string_view text)
+  {
+    store(text);
+  }
+
+  virtual void endElement(std::string_view text, std::string_view)
   {
+    doEndElement();
+
     store(text);
   }
 
-  virtual void endElement(const std::string &text, const std::string &)
+  virtual void point(std::string_view text, const XMLPoint &point)
   {
+    double lat, lon = 0.0;
+
+    if (_path.push(point._name) == GpxPath::TRKPT && getDouble(point._lat, lat) && getDouble(point._lon, lon))
+    {
+      doTrackPoint(lat, lon);
+    }
+
     doEndElement();
 
     store(text);
@@ -238,8 +267,10 @@ private:
   // Members
   double            _distance;
 
-  std::string       _path;
-  std::string       _current;
+  XMLOutput         _output;
+
+  GpxPath           _path;
+  XMLOutputPart     _current;
   double            _lastLat;
   double            _lastLon;
   bool              _doConcat;
@@ -5,6 +5,8 @@
 #include <iomanip>
 #include <cmath>
 
+#include "XMLNumber.h"
+
 const std::string tool    = "gpxformat";
 const std::string version = "0.1.0";
 
@@ -59,9 +61,7 @@ bool scanValue(const std::string &input, std::size_t &i, double &value, bool &wi
     }
   }
 
-  value = std::stod(text);
-
-  return true;
+  return XMLNumber::toDouble(text, value);
 }
 
 // -- Scan the coordinate -----------------------------------------------------
@@ -1,19 +1,22 @@
 #include <iostream>
 #include <cstring>
-#include <fstream>
+#include <unistd.h>
 #include <vector>
 #include <cmath>
 #include <limits>
-#include <iomanip>
 
-#include "XMLParser.h"
+#include "ParallelXMLParser.h"
+#include "XMLInput.h"
+#include "XMLOutput.h"
+#include "XMLNumber.h"
+#include "GpxPath.h"
 
 const std::string tool    = "gpxjson";
 const std::string version = "0.1.0";
 
 // ----------------------------------------------------------------------------
 
-class GpxJson : public XMLParserHandler
+class GpxJson : public BasicXMLParserHandler
 {
 public:
   // -- Constructor -----------------------------------------------------------
@@ -22,12 +25,13 @@ public:
     _tracks(false),
     _routes(false),
     _mode(NORMAL),
-    _number(4)
+    _number(4),
+    _precision(6)
   {
   }
 
   // -- Deconstructor ---------------------------------------------------------
-  virtual ~GpxJson()
+  ~GpxJson()
   {
   }
 
@@ -39,6 +43,10 @@ public:
 
   void setNumber(int number) { _number = number; }
 
+  static const int SHORTEST = -1;
+
+  void setPrecision(int precision) { _precision = precision; }
+
   void convertWaypoints() { _waypoints = true; }
 
   void convertTracks() { _tracks = true; }
@@ -46,13 +54,23 @@ public:
   void convertRoutes() { _routes = true; }
 
   // -- Parse a file ----------------------------------------------------------
-  bool parseFile(std::istream &input, std::ostream &output)
+  bool parseFile(XMLInput &input, XMLOutput &output)
   {
     _path.clear();
     _lines.clear();
     _points.clear();
 
-    XMLParser parser(this);
+    // Only the coordinates of the points are needed
+    XMLParserFilter filter;
+
+    filter.setAttributesFor({ "wpt", "rtept", "trkpt" });
+    filter.setSkipFor({ "extensions" });
+    filter.setPointsFor({ "wpt", "rtept", "trkpt" });
+    filter.setPointBatchSize(4096);
+
+    ParallelXMLParser<GpxJson> parser(this);
+
+    parser.setFilter(filter);
 
     parser.parse(input);
 
@@ -61,28 +79,18 @@ public:
     return true;
   }
 
-  static double getDouble(const std::string &value)
+  static double getDouble(std::string_view value)
   {
-    try
-    {
-      return std::stod(value);
-    }
-    catch (...)
-    {
-      return std::numeric_limits<double>::min();
-    }
+    double result;
+
+    return XMLNumber::toDouble(value, result) ? result : std::numeric_limits<double>::min();
   }
 
   static double getInt(const std::string &value)
   {
-    try
-    {
-      return std::stoi(value);
-    }
-    catch (...)
-    {
-      return 0;
-    }
+    int result;
+
+    return XMLNumber::toInt(value, result) ? result : 0;
   }
 
 private:
@@ -100,7 +108,7 @@ private:
   };
 
 
-  void outputJson(std::ostream &output)
+  void outputJson(XMLOutput &output)
   {
     int points = _points.size();
     int lines  = _lines.size();
@@ -112,39 +120,37 @@ private:
     if (lines >  1) outputMultipleLines(output);
   }
 
-  void outputOnePoint(std::ostream &output)
+  void outputOnePoint(XMLOutput &output)
   {
-    output << std::fixed << std::setprecision(6);
-    output << '{'; doEndl(output);
+    output.put('{'); doEndl(output);
     doIndent();
-    output << _indent << "\"type\":\"Point\","; doEndl(output);
-    output << _indent << "\"coordinates\":[" << _points.front()._lon << ',' << _points.front()._lat << "]"; doEndl(output);
+    output.write(_indent); output.write("\"type\":\"Point\","); doEndl(output);
+    output.write(_indent); output.write("\"coordinates\":["); outputCoordinates(output, _points.front()); output.put(']'); doEndl(output);
     doOutdent();
-    output << '}'; doEndl(output);
+    output.put('}'); doEndl(output);
   }
 
-  void outputMultiplePoints(std::ostream &output)
+  void outputMultiplePoints(XMLOutput &output)
   {
-    output << std::fixed << std::setprecision(6);
-    output << '{'; doEndl(output);
+    output.put('{'); doEndl(output);
     doIndent();
-    output << _indent << "\"type\":\"MultiPoint\","; doEndl(output);
-    output << _indent << "\"coordinates\":["; doEndl(output);
+    output.write(_indent); output.write("\"type\":\"MultiPoint\","); doEndl(output);
+    output.write(_indent); output.write("\"coordinates\":["); doEndl(output);
     doIndent();
 
     auto iter = _points.begin();
     while (iter != _points.end())
     {
-      output << _indent;
+      output.write(_indent);
 
       int count = 0;
       while (iter != _points.end() && count < _number)
       {
         auto next = iter + 1;
 
-        output << '[' << iter->_lon << ',' << iter->_lat << ']';
+        output.put('['); outputCoordinates(output, *iter); output.put(']');
 
-        if (next != _points.end()) output << ',';
+        if (next != _points.end()) output.put(',');
 
         ++iter; count++;
       }
@@ -152,18 +158,17 @@ private:
     }
 
     doOutdent();
-    output << _indent << "]"; doEndl(output);
+    output.write(_indent); output.write("]"); doEndl(output);
     doOutdent();
-    output << '}'; doEndl(output);
+    output.put('}'); doEndl(output);
   }
 
-  void outputOneLine(std::ostream &output)
+  void outputOneLine(XMLOutput &output)
   {
-    output << std::fixed << std::setprecision(6);
-    output << '{'; doEndl(output);
+    output.put('{'); doEndl(output);
     doIndent();
-    output << _indent << "\"type\":\"LineString\","; doEndl(output);
-    output << _indent << "\"coordinates\":["; doEndl(output);
+    output.write(_indent); output.write("\"type\":\"LineString\","); doEndl(output);
+    output.write(_indent); output.write("\"coordinates\":["); doEndl(output);
     doIndent();
 
     auto iter = _lines.front().begin();
@@ -171,16 +176,16 @@ private:
 
     while (iter != end)
     {
-      output << _indent;
+      output.write(_indent);
 
       int count = 0;
       while (iter != end && count < _number)
       {
         auto next = iter + 1;
 
-        output << '[' << iter->_lon << ',' << iter->_lat << ']';
+        output.put('['); outputCoordinates(output, *iter); output.put(']');
 
-        if (next != end) output << ',';
+        if (next != end) output.put(',');
 
         ++iter; count++;
       }
@@ -188,41 +193,40 @@ private:
     }
 
     doOutdent();
-    output << _indent << "]"; doEndl(output);
+    output.write(_indent); output.write("]"); doEndl(output);
     doOutdent();
-    output << '}'; doEndl(output);
+    output.put('}'); doEndl(output);
   }
 
-  void outputMultipleLines(std::ostream &output)
+  void outputMultipleLines(XMLOutput &output)
   {
-    output << std::fixed << std::setprecision(6);
-    output << '{'; doEndl(output);
+    output.put('{'); doEndl(output);
     doIndent();
-    output << _indent << "\"type\":\"MultiLineString\","; doEndl(output);
-    output << _indent << "\"coordinates\":["; doEndl(output);
+    output.write(_indent); output.write("\"type\":\"MultiLineString\","); doEndl(output);
+    output.write(_indent); output.write("\"coordinates\":["); doEndl(output);
     doIndent();
 
-    output << _indent;
+    output.write(_indent);
     for (auto iter2 = _lines.begin(); iter2 != _lines.end(); ++iter2)
     {
       auto next2 = iter2 + 1;
 
-      output << "["; doEndl(output);
+      output.put('['); doEndl(output);
       doIndent();
 
       auto iter = iter2->begin();
       while (iter != iter2->end())
       {
-        output << _indent;
+        output.write(_indent);
 
         int count = 0;
         while (iter != iter2->end() && count < _number)
         {
           auto next = iter + 1;
 
-          output << '[' << iter->_lon << ',' << iter->_lat << ']';
+          output.put('['); outputCoordinates(output, *iter); output.put(']');
 
-          if (next != iter2->end()) output << ',';
+          if (next != iter2->end()) output.put(',');
 
           ++iter; count++;
         }
@@ -230,21 +234,37 @@ private:
       }
       doOutdent();
 
-      output << _indent << "]";
-      if (next2 != _lines.end()) output << ",";
+      output.write(_indent); output.write("]");
+      if (next2 != _lines.end()) output.put(',');
     }
     doEndl(output);
     doOutdent();
 
-    output << _indent << "]"; doEndl(output);
+    output.write(_indent); output.write("]"); doEndl(output);
     doOutdent();
 
-    output << "}"; doEndl(output);
+    output.put('}'); doEndl(output);
   }
 
-  void doEndl(std::ostream &output)
+  void outputCoordinates(XMLOutput &output, const Point &point)
   {
-    if (_mode == NORMAL) output << std::endl;
+    if (_precision == SHORTEST)
+    {
+      output.writeShortest(point._lon);
+      output.put(',');
+      output.writeShortest(point._lat);
+    }
+    else
+    {
+      output.writeFixed(point._lon, _precision);
+      output.put(',');
+      output.writeFixed(point._lat, _precision);
+    }
+  }
+
+  void doEndl(XMLOutput &output)
+  {
+    if (_mode == NORMAL) output.put('\n');
   }
 
   void doIndent()
@@ -257,33 +277,32 @@ private:
     if (_mode == NORMAL) _indent.erase(_indent.size()-2);
   }
 
-  static double getDoubleAttribute(const Attributes &atts, const std::string &key)
+  static double getDoubleAttribute(const Attributes &atts, std::string_view key)
   {
-    auto iter = atts.find(key);
+    double value;
 
-    return iter != atts.end() ? getDouble(iter->second) : std::numeric_limits<double>::min();
+    return atts.getDouble(key, value) ? value : std::numeric_limits<double>::min();
   }
 
 
-  void doStartElement(const std::string &name, const Attributes &attributes)
+  void doStartElement(std::string_view name, const Attributes &attributes)
   {
-    _path.append("/");
-    _path.append(name);
+    GpxPath::State state = _path.push(name);
 
-    if ((_tracks && _path == "/gpx/trk/trkseg") ||
-        (_routes && _path == "/gpx/rte"))
+    if ((_tracks && state == GpxPath::TRKSEG) ||
+        (_routes && state == GpxPath::RTE))
     {
       _line.clear();
     }
-    else if ((_tracks && _path == "/gpx/trk/trkseg/trkpt") ||
-             (_routes && _path == "/gpx/rte/rtept"))
+    else if ((_tracks && state == GpxPath::TRKPT) ||
+             (_routes && state == GpxPath::RTEPT))
     {
       double lat = getDoubleAttribute(attributes, "lat");
       double lon = getDoubleAttribute(attributes, "lon");
 
       _line.push_back(Point(lat, lon));
     }
-    else if (_waypoints && _path == "/gpx/wpt")
+    else if (_waypoints && state == GpxPath::WPT)
     {
       double lat = getDoubleAttribute(attributes, "lat");
       double lon = getDoubleAttribute(attributes, "lon");
@@ -294,64 +313,57 @@ private:
 
   void doEndElement()
   {
-    if ((_tracks && _path == "/gpx/trk/trkseg") ||
-        (_routes && _path == "/gpx/rte"))
+    GpxPath::State state = _path.state();
+
+    if ((_tracks && state == GpxPath::TRKSEG) ||
+        (_routes && state == GpxPath::RTE))
     {
       _lines.push_back(_line);
     }
 
-    size_t i =  _path.find_last_of('/');
-
-    if (i != std::string::npos) _path.erase(i);
+    _path.pop();
   }
 
 public:
   // -- Callbacks -------------------------------------------------------------
-  virtual void xmlDecl(const std::string &, const Attributes &)
-  {
-  }
-
-  virtual void processingInstruction(const std::string &, const std::string &, const std::string &)
-  {
-  }
-
-  virtual void docTypeDecl(const std::string &)
-  {
-  }
-
-  virtual void unhandled(const std::string &text, int lineNumber, int columnNumber)
+  void unhandled(std::string_view text, int lineNumber, int columnNumber)
   {
     std::cerr << "  ERROR: Unexpected gpx info: " << text <<  " on line: " << lineNumber << " columnNumber: " << columnNumber << std::endl;
     exit(1);
   }
 
-  virtual void cdataDecl(const std::string &, const std::string &)
-  {
-  }
-
-  virtual void comment(const std::string &, const std::string &)
-  {
-  }
-
-  virtual void startEndElement(const std::string &, const std::string &name, const Attributes &attributes)
+  void startEndElement(std::string_view, std::string_view name, const Attributes &attributes)
   {
     doStartElement(name, attributes);
 
     doEndElement();
   }
 
-  virtual void startElement(const std::string &, const std::string &name, const Attributes &attributes)
+  void startElement(std::string_view, std::string_view name, const Attributes &attributes)
   {
     doStartElement(name, attributes);
   }
 
-  virtual void text(const std::string &)
+  void endElement(std::string_view, std::string_view)
   {
+    doEndElement();
   }
 
-  virtual void endElement(const std::string &, const std::string &)
+  void pointBatch(const XMLPointBatch &batch)
   {
-    doEndElement();
+    GpxPath::State state = _path.push(batch._name);
+
+    if ((_tracks && state == GpxPath::TRKPT) ||
+        (_routes && state == GpxPath::RTEPT))
+    {
+      for (std::size_t i = 0; i < batch.size(); i++) _line.push_back(Point(batch._lat[i], batch._lon[i]));
+    }
+    else if (_waypoints && state == GpxPath::WPT)
+    {
+      for (std::size_t i = 0; i < batch.size(); i++) _points.push_back(Point(batch._lat[i], batch._lon[i]));
+    }
+
+    _path.pop();
   }
 
 private:
@@ -359,7 +371,7 @@ private:
   typedef std::vector<Point>  Line;
 
   // Members
-  std::string         _path;
+  GpxPath             _path;
 
   bool                _waypoints;
   bool                _tracks;
@@ -367,6 +379,7 @@ private:
 
   Mode                _mode;
   int                 _number;
+  int                 _precision;
 
   Line                _line;
 
@@ -390,7 +403,7 @@ int main(int argc, char *argv[])
   {
     if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-?") == 0)
     {
-      std::cout << "Usage: " << tool << " [-h] [-v] [-w] [-r] [-t] [-m compact|normal] [-n <number>] [-o <out.json>] [<file.gpx>]" << std::endl;
+      std::cout << "Usage: " << tool << " [-h] [-v] [-w] [-r] [-t] [-m compact|normal] [-n <number>] [-p <precision>] [-o <out.json>] [<file.gpx>]" << std::endl;
       std::cout << "  -h                   help" << std::endl;
       std::cout << "  -v                   show version" << std::endl;
       std::cout << "  -w                   convert the waypoints" << std::endl;
@@ -398,7 +411,10 @@ int main(int argc, char *argv[])
       std::cout << "  -r                   convert the routes" << std::endl;
       std::cout << "  -m compact|normal    set the output mode" << std::endl;
       std::cout << "  -n <number>          set the number of points per line (in normal mode) (def. 4)" << std::endl;
+      std::cout << "  -p <precision>       set the number of decimals of the coordinates (def. 6)," << std::endl;
+      std::cout << "                       'shortest' for the shortest exact representation" << std::endl;
       std::cout << "  -o <out.json>        the output json file (overwrites existing file)" << std::endl;
+      std::cout << "                       a .gz file is written gzip compressed" << std::endl;
       std::cout << " file.gpx              the input gpx file" << std::endl << std::endl;
       std::cout << "   Convert a gpx file to GeoJson." << std::endl;
       return 0;
@@ -450,6 +466,24 @@ int main(int argc, char *argv[])
         std::cerr << "Error: invalid number: " << argv[i] << std::endl;
       }
     }
+    else if (strcmp(argv[i], "-p") == 0 && i+1 < argc)
+    {
+      int precision;
+
+      i++;
+      if (strcmp(argv[i], "shortest") == 0)
+      {
+        gpxJson.setPrecision(GpxJson::SHORTEST);
+      }
+      else if (XMLNumber::toInt(argv[i], precision) && precision >= 0 && precision <= 17)
+      {
+        gpxJson.setPrecision(precision);
+      }
+      else
+      {
+        std::cerr << "Error: invalid precision: " << argv[i] << std::endl;
+      }
+    }
     else if (strcmp(argv[i], "-o") == 0 && i+1 < argc)
     {
       if (outputFilename.empty())
@@ -484,35 +518,39 @@ int main(int argc, char *argv[])
   }
 
 
-  std::ifstream input;
+  XMLInput input;
 
   if (!inputFilename.empty())
   {
-    input.open(inputFilename.c_str());
-
-    if (!input.is_open())
+    if (!input.open(inputFilename))
     {
       std::cerr << "Error: unable to open the inputfile: " << inputFilename << std::endl;
       return 1;
     }
   }
+  else
+  {
+    input.open(STDIN_FILENO);
+  }
 
-  std::ofstream output;
+  XMLOutput output;
 
   if (!outputFilename.empty())
   {
-    output.open(outputFilename.c_str());
-
-    if (!output.is_open())
+    if (!output.open(outputFilename))
     {
       std::cerr << "Error: unable to open the outputfile: " << outputFilename << std::endl;
     }
   }
+  else
+  {
+    output.open(STDOUT_FILENO);
+  }
 
-  gpxJson.parseFile((inputFilename.empty() ? std::cin : input), (outputFilename.empty() ? std::cout : output));
+  gpxJson.parseFile(input, output);
 
-  if (!inputFilename .empty()) input.close();
-  if (!outputFilename.empty()) output.close();
+  input.close();
+  output.close();
   
   return 0;
 }
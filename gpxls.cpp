@@ -1,19 +1,25 @@
 #include <iostream>
 #include <cstring>
-#include <fstream>
 #include <list>
 #include <limits>
-#include <iomanip>
+#include <utility>
+#include <unistd.h>
 
 #include "XMLParser.h"
+#include "ParallelXMLParser.h"
+#include "XMLInput.h"
+#include "XMLOutput.h"
+#include "XMLNumber.h"
+#include "GpxPath.h"
 
 // ----------------------------------------------------------------------------
 
-class GpxLs : public XMLParserHandler
+class GpxLs : public BasicXMLParserHandler
 {
 public:
   // -- Constructor -----------------------------------------------------------
-  GpxLs() :
+  GpxLs(XMLOutput &output) :
+    _output(output),
     _waypoints(),
     _routes(),
     _tracks()
@@ -22,7 +28,7 @@ public:
   }
 
   // -- Deconstructor----------------------------------------------------------
-  virtual ~GpxLs()
+  ~GpxLs()
   {
 
   }
@@ -30,97 +36,116 @@ public:
   // -- Properties ------------------------------------------------------------
 
   // -- Parse a file ----------------------------------------------------------
-  bool parseFile(const std::string &name)
+  enum Mode { SUMMARY, FULL };
+
+  bool parseFile(const std::string &name, Mode mode)
   {
-    std::ifstream stream(name.c_str());
+    XMLInput input;
 
-    if (!stream.is_open()) return false;
+    if (!input.open(name)) return false;
 
     _path.clear();
 
-    std::cout << name << ":" << std::endl;
+    _output.write(name); _output.write(":\n");
 
-    XMLParser parser;
+    // Only the reported attributes and text are needed
+    XMLParserFilter filter;
+
+    filter.setSkipFor({ "extensions" });
+
+    if (mode == FULL)
+    {
+      filter.setAttributesFor({ "wpt", "rtept", "trkpt" });
+      filter.setTextFor({ "name", "ele", "time" });
+      filter.setPointsFor({ "wpt", "rtept", "trkpt" });
+      filter.setPointBatchSize(4096);
+    }
+    else
+    {
+      filter.setAttributesFor({ });
+      filter.setTextFor({ "name", "time" });
+    }
+
+    ParallelXMLParser<GpxLs> parser;
 
     parser.setHandler(this);
+    parser.setFilter(filter);
 
-    parser.parse(stream);
+    parser.parse(input);
 
-    stream.close();
+    input.close();
 
     return true;
   }
 
   // -- Output the result -----------------------------------------------------
-  enum Mode { SUMMARY, FULL };
-
   void report(Mode mode)
   {
-    std::cout << "  Waypoints: " << _waypoints.size() << std::endl;
+    _output.write("  Waypoints: "); _output.writeInt(_waypoints.size()); _output.put('\n');
 
     if (mode == FULL && !_waypoints.empty())
     {
-      std::cout << "    Waypoint     Latitude  Longitude Time                    Elevation" << std::fixed << std::endl;
+      _output.write("    Waypoint     Latitude  Longitude Time                    Elevation\n");
 
       for (auto iter = _waypoints.begin(); iter != _waypoints.end(); ++iter)
       {
-        std::cout << "    ";
+        _output.write("    ");
         report(XMLParser::trim(iter->_name), 10);
         report(iter->_lat, 10, 5);
         report(iter->_lon, 10, 5);
         report(XMLParser::trim(iter->_time), 24);
         report(iter->_ele, 8, 3);
-        std::cout  << std::endl;
+        _output.put('\n');
       }
     }
 
-    std::cout << "  Routes:    " << _routes.size() << std::endl;
+    _output.write("  Routes:    "); _output.writeInt(_routes.size()); _output.put('\n');
     for(auto iter = _routes.begin(); iter != _routes.end(); ++iter)
     {
-      std::cout << "    Route: '" << iter->_name << "' Points: " << iter->_points.size() << std::endl;
+      _output.write("    Route: '"); _output.write(iter->_name); _output.write("' Points: "); _output.writeInt(iter->_points.size()); _output.put('\n');
 
       if (mode == FULL && !iter->_points.empty())
       {
-        std::cout << "        Latitude  Longitude" << std::fixed << std::endl;
+        _output.write("        Latitude  Longitude\n");
 
         for (auto iter2 = iter->_points.begin(); iter2 != iter->_points.end(); ++iter2)
         {
-          std::cout << "      ";
+          _output.write("      ");
           report(iter2->_lat, 10, 5);
           report(iter2->_lon, 10, 5);
-          std::cout << std::endl;
+          _output.put('\n');
         }
       }
     }
 
-    std::cout << "  Tracks:    " << _tracks.size() << std::endl;
+    _output.write("  Tracks:    "); _output.writeInt(_tracks.size()); _output.put('\n');
     for (auto iter = _tracks.begin(); iter != _tracks.end(); ++iter)
     {
-      std::cout << "    Track: '" << iter->_name << "' Segments: " << iter->_segments.size() << std::endl;
+      _output.write("    Track: '"); _output.write(iter->_name); _output.write("' Segments: "); _output.writeInt(iter->_segments.size()); _output.put('\n');
 
       int i = 1;
       for (auto iter2 = iter->_segments.begin(); iter2 != iter->_segments.end(); ++iter2, i++)
       {
-        std::cout << "      Segment: " << std::setw(2) << i << " Points: " << std::setw(4) << iter2->_points.size();
+        _output.write("      Segment: "); _output.writeInt(i, 2); _output.write(" Points: "); _output.writeInt(iter2->_points.size(), 4);
 
         if (!iter2->_minTime.empty() && !iter2->_maxTime.empty())
         {
-          std::cout << " Bounds: " << iter2->_minTime << "..." << iter2->_maxTime;
+          _output.write(" Bounds: "); _output.write(iter2->_minTime); _output.write("..."); _output.write(iter2->_maxTime);
         }
-        std::cout << std::endl;
+        _output.put('\n');
 
         if (mode == FULL && !iter2->_points.empty())
         {
-          std::cout << "          Latitude  Longitude Time                    Elevation" << std::fixed << std::endl;
+          _output.write("          Latitude  Longitude Time                    Elevation\n");
 
           for (auto iter3 = iter2->_points.begin(); iter3 != iter2->_points.end(); ++iter3)
           {
-            std::cout << "        ";
+            _output.write("        ");
             report(iter3->_lat, 10, 5);
             report(iter3->_lon, 10, 5);
             report(XMLParser::trim(iter3->_time), 24);
             report(iter3->_ele, 8, 3);
-            std::cout << std::endl;
+            _output.put('\n');
           }
         }
       }
@@ -129,205 +154,240 @@ public:
 
 
   // -- Callbacks -------------------------------------------------------------
-  virtual void xmlDecl(const std::string &, const Attributes &)
-  {
-    // Skipping
-  }
-
-  virtual void processingInstruction(const std::string &, const std::string &, const std::string &)
+  void unhandled(std::string_view text, int lineNumber, int columnNumber)
   {
-    // Skipping
-  }
+    _output.close();
 
-  virtual void docTypeDecl(const std::string &)
-  {
-    // Skipping
-  }
-
-  virtual void unhandled(const std::string &text, int lineNumber, int columnNumber)
-  {
     std::cerr << "  ERROR: Unexpected gpx info: " << text <<  " on line: " << lineNumber << " columnNumber: " << columnNumber << std::endl;
     exit(1);
   }
 
-  virtual void cdataDecl(const std::string &, const std::string &)
-  {
-    // Skipping
-  }
-
-  virtual void comment(const std::string &, const std::string &)
-  {
-    // Skipping
-  }
-
-  virtual void startEndElement(const std::string &text, const std::string &name, const Attributes &attributes)
+  void startEndElement(std::string_view text, std::string_view name, const Attributes &attributes)
   {
     startElement(text, name, attributes);
     endElement(text, name);
   }
 
 
-  virtual void startElement(const std::string &, const std::string &name, const Attributes &atts)
+  void startElement(std::string_view, std::string_view name, const Attributes &atts)
   {
-    _path.append("/");
-    _path.append(name);
-
-    if (_path == "/gpx/wpt")
+    switch (_path.push(name))
     {
-      _waypoint.reset();
+      case GpxPath::WPT:
+        _waypoint.reset();
 
-      _waypoint._lat = getDoubleAttribute(atts, "lat");
-      _waypoint._lon = getDoubleAttribute(atts, "lon");
-    }
-    else if (_path == "/gpx/rte")
-    {
-      _route.reset();
-    }
-    else if (_path == "/gpx/rte/rtept")
-    {
-      _routepoint.reset();
+        _waypoint._lat = getDoubleAttribute(atts, "lat");
+        _waypoint._lon = getDoubleAttribute(atts, "lon");
+        break;
 
-      _routepoint._lat = getDoubleAttribute(atts, "lat");
-      _routepoint._lon = getDoubleAttribute(atts, "lon");
-    }
-    else if (_path == "/gpx/trk")
-    {
-      _track.reset();
-    }
-    else if (_path == "/gpx/trk/trkseg")
-    {
-      _trackSegment.reset();
-    }
-    else if (_path == "/gpx/trk/trkseg/trkpt")
-    {
-      _trackpoint.reset();
+      case GpxPath::RTE:
+        _route.reset();
+        break;
+
+      case GpxPath::RTEPT:
+        _routepoint.reset();
+
+        _routepoint._lat = getDoubleAttribute(atts, "lat");
+        _routepoint._lon = getDoubleAttribute(atts, "lon");
+        break;
 
-      _trackpoint._lat = getDoubleAttribute(atts, "lat");
-      _trackpoint._lon = getDoubleAttribute(atts, "lon");
+      case GpxPath::TRK:
+        _track.reset();
+        break;
+
+      case GpxPath::TRKSEG:
+        _trackSegment.reset();
+        break;
+
+      case GpxPath::TRKPT:
+        _trackpoint.reset();
+
+        _trackpoint._lat = getDoubleAttribute(atts, "lat");
+        _trackpoint._lon = getDoubleAttribute(atts, "lon");
+        break;
+
+      default:
+        break;
     }
   }
 
-  virtual void text(const std::string &text)
+  void text(std::string_view text)
   {
-    if (_path == "/gpx/wpt/name")
-    {
-      _waypoint._name = text;
-    }
-    else if (_path == "/gpx/wpt/ele")
-    {
-      _waypoint._ele = getDouble(text);
-    }
-    else if (_path == "/gpx/wpt/time")
-    {
-      _waypoint._time = text;
-    }
-    else if (_path == "/gpx/rte/name")
-    {
-      _route._name = text;
-    }
-    else if (_path == "/gpx/trk/name")
-    {
-      _track._name = text;
-    }
-    else if (_path == "/gpx/trk/trkseg/trkpt/ele")
-    {
-      _trackpoint._ele = getDouble(text);
-    }
-    else if (_path == "/gpx/trk/trkseg/trkpt/time")
+    switch (_path.state())
     {
-      _trackpoint._time = text;
+      case GpxPath::WPT_NAME:
+        _waypoint._name = text;
+        break;
+
+      case GpxPath::WPT_ELE:
+        _waypoint._ele = getDouble(text);
+        break;
+
+      case GpxPath::WPT_TIME:
+        _waypoint._time = text;
+        break;
+
+      case GpxPath::RTE_NAME:
+        _route._name = text;
+        break;
+
+      case GpxPath::TRK_NAME:
+        _track._name = text;
+        break;
+
+      case GpxPath::TRKPT_ELE:
+        _trackpoint._ele = getDouble(text);
+        break;
+
+      case GpxPath::TRKPT_TIME:
+        _trackpoint._time = text;
+        break;
+
+      default:
+        break;
     }
   }
 
-  virtual void endElement(const std::string &, const std::string &)
+  void pointBatch(const XMLPointBatch &batch)
   {
-    if (_path == "/gpx/wpt")
-    {
-      _waypoints.push_back(_waypoint);
-    }
-    else if (_path == "/gpx/rte/rtept")
-    {
-      _route._points.push_back(_routepoint);
-    }
-    else if (_path == "/gpx/rte")
-    {
-      _routes.push_back(_route);
-    }
-    else if (_path == "/gpx/trk")
-    {
-      _tracks.push_back(_track);
-    }
-    else if (_path == "/gpx/trk/trkseg")
-    {
-      _track._segments.push_back(_trackSegment);
-    }
-    else if (_path == "/gpx/trk/trkseg/trkpt")
+    GpxPath::State state = _path.push(batch._name);
+
+    for (std::size_t i = 0; i < batch.size(); i++)
     {
-      if (_trackpoint._time.size() >= 18)
+      switch (state)
       {
-        if (_trackSegment._minTime.empty() || _trackSegment._minTime > _trackpoint._time) _trackSegment._minTime = _trackpoint._time;
-        if (_trackSegment._maxTime.empty() || _trackSegment._maxTime < _trackpoint._time) _trackSegment._maxTime = _trackpoint._time;
+        case GpxPath::WPT:
+          _waypoint.reset();
+
+          _waypoint._lat  = batch._lat[i];
+          _waypoint._lon  = batch._lon[i];
+          _waypoint._ele  = batch._ele[i];
+          _waypoint._time = batch._time[i];
+
+          _waypoints.push_back(_waypoint);
+          break;
+
+        case GpxPath::RTEPT:
+          _routepoint.reset();
+
+          _routepoint._lat = batch._lat[i];
+          _routepoint._lon = batch._lon[i];
+
+          _route._points.push_back(_routepoint);
+          break;
+
+        case GpxPath::TRKPT:
+          _trackpoint.reset();
+
+          _trackpoint._lat  = batch._lat[i];
+          _trackpoint._lon  = batch._lon[i];
+          _trackpoint._ele  = batch._ele[i];
+          _trackpoint._time = batch._time[i];
+
+          addTrackpoint();
+          break;
+
+        default:
+          break;
       }
+    }
+
+    _path.pop();
+  }
+
+  void endElement(std::string_view, std::string_view)
+  {
+    switch (_path.state())
+    {
+      case GpxPath::WPT:
+        _waypoints.push_back(_waypoint);
+        break;
+
+      case GpxPath::RTEPT:
+        _route._points.push_back(_routepoint);
+        break;
+
+      case GpxPath::RTE:
+        _routes.push_back(std::move(_route));
+        break;
+
+      case GpxPath::TRK:
+        _tracks.push_back(std::move(_track));
+        break;
 
-      _trackSegment._points.push_back(_trackpoint);
+      case GpxPath::TRKSEG:
+        _track._segments.push_back(std::move(_trackSegment));
+        break;
+
+      case GpxPath::TRKPT:
+        addTrackpoint();
+        break;
+
+      default:
+        break;
     }
 
-    size_t i;
-    if ((i = _path.find_last_of('/')) != std::string::npos) _path.erase(i);
+    _path.pop();
   }
 
 // -- Privates ----------------------------------------------------------------
 private:
 
-  double getDouble(const std::string &value)
+  void addTrackpoint()
   {
-    try
-    {
-      return std::stod(value);
-    }
-    catch (...)
+    if (_trackpoint._time.size() >= 18)
     {
-      return std::numeric_limits<double>::min();
+      if (_trackSegment._minTime.empty() || _trackSegment._minTime > _trackpoint._time) _trackSegment._minTime = _trackpoint._time;
+      if (_trackSegment._maxTime.empty() || _trackSegment._maxTime < _trackpoint._time) _trackSegment._maxTime = _trackpoint._time;
     }
+
+    _trackSegment._points.push_back(_trackpoint);
   }
 
-  double getDoubleAttribute(const Attributes &atts, const std::string &key)
+  double getDouble(std::string_view value)
   {
-    auto iter = atts.find(key);
+    double result;
 
-    return iter != atts.end() ? getDouble(iter->second) : std::numeric_limits<double>::min();
+    return XMLNumber::toDouble(value, result) ? result : std::numeric_limits<double>::min();
+  }
+
+  double getDoubleAttribute(const Attributes &atts, std::string_view key)
+  {
+    double value;
+
+    return atts.getDouble(key, value) ? value : std::numeric_limits<double>::min();
   }
 
   void report(double value, int width, int precision)
   {
     if (value == std::numeric_limits<double>::min())
     {
-      std::cout << std::setw(width) << ' ';
+      _output.writeSpaces(width);
     }
     else
     {
-      std::cout << std::setw(width) << std::setprecision(precision) << value;
+      _output.writeFixed(value, precision, width);
     }
-    std::cout << ' ';
+    _output.put(' ');
   }
 
   void report(const std::string &value, size_t width)
   {
-    std::cout << std::left;
     if (value.size() > width)
     {
-      std::cout << value.substr(0, width-3) << "...";
+      _output.write(std::string_view(value).substr(0, width-3)); _output.write("...");
     }
     else
     {
-      std::cout << std::setw(width) << value;
+      _output.write(value); _output.writeSpaces(width - value.size());
     }
-    std::cout << ' ';
-    std::cout << std::right;
+    _output.put(' ');
   }
 
   // -- Members ---------------------------------------------------------------
-  std::string   _path;
+  XMLOutput    &_output;
+
+  GpxPath       _path;
 
   struct Waypoint
   {
@@ -432,6 +492,10 @@ int main(int argc, char *argv[])
 {
   GpxLs::Mode mode = GpxLs::SUMMARY;
 
+  XMLOutput output;
+
+  output.open(STDOUT_FILENO);
+
   for (int i = 1; i < argc; i++)
   {
     if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-?") == 0)
@@ -460,14 +524,16 @@ int main(int argc, char *argv[])
     }
     else if (argv[i][0] != '-')
     {
-      GpxLs gpxls;
+      GpxLs gpxls(output);
 
-      if (gpxls.parseFile(argv[i]))
+      if (gpxls.parseFile(argv[i], mode))
       {
         gpxls.report(mode);
       }
       else
       {
+        output.flush();
+
         std::cerr << "Unable to open: " << argv[i] << std::endl;
       }
     }
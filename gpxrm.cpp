@@ -1,18 +1,21 @@
 #include <iostream>
 #include <cstring>
-#include <fstream>
+#include <unistd.h>
 
 #include "XMLParser.h"
+#include "XMLInput.h"
+#include "XMLOutput.h"
+#include "GpxPath.h"
 
 const std::string version= "0.1.0";
 // ----------------------------------------------------------------------------
 
-class GpxRm : public XMLParserHandler
+class GpxRm : public XMLParserViewHandler
 {
 public:
   // -- Constructor -----------------------------------------------------------
   GpxRm() :
-    _outputFile(&std::cout),
+    _output(nullptr),
     _segmentNr(0),
     _inWaypoint(false),
     _inRoute(false),
@@ -40,143 +43,162 @@ public:
   const std::string &routeName() const { return _routeName; }
 
   // -- Parse a file ----------------------------------------------------------
-  bool parseFile(std::istream &input, std::ostream &output)
+  bool parseFile(XMLInput &input, XMLOutput &output)
   {
     _path.clear();
 
-    _outputFile = &output;
+    // The unchanged text is copied from the input
+    _output = &output;
+
+    _output->setInput(&input);
+
+    // The extensions are not used, but copied
+    XMLParserFilter filter;
+
+    filter.setSkipFor({ "extensions" });
 
     XMLParser parser(this);
 
+    parser.setFilter(filter);
+
     parser.parse(input);
 
+    _output->setInput(nullptr);
+
     return true;
   }
 
 private:
-  void log(const std::string &text)
+  void log(std::string_view text)
   {
     if (_inWaypoint || _inRoute || _inTrack || _inSegment)
     {
-      _currentText.append(text);
+      _output->append(_currentText, text);
     }
     else
     {
-      *_outputFile << text;
+      _output->write(text);
     }
   }
 
-  void doStartElement(const std::string &name)
+  void doStartElement(std::string_view name)
   {
-    _path.append("/");
-    _path.append(name);
-
-    if (_path == "/gpx/wpt")
+    switch (_path.push(name))
     {
-      if (!_waypointName.empty()) _inWaypoint = true;
+      case GpxPath::WPT:
+        if (!_waypointName.empty()) _inWaypoint = true;
 
-      _currentText.clear();
-      _currentName.clear();
+        _currentText.clear();
+        _currentName.clear();
 
-      _currentSegmentNr = 0;
-    }
-    else if (_path == "/gpx/rte")
-    {
-      if (!_routeName.empty()) _inRoute = true;
+        _currentSegmentNr = 0;
+        break;
 
-      _currentText.clear();
-      _currentName.clear();
+      case GpxPath::RTE:
+        if (!_routeName.empty()) _inRoute = true;
 
-      _currentSegmentNr = 0;
-    }
-    else if (_path == "/gpx/trk")
-    {
-      if (!_trackName.empty() && _segmentNr == 0) _inTrack = true;
+        _currentText.clear();
+        _currentName.clear();
 
-      _currentText.clear();
-      _currentName.clear();
+        _currentSegmentNr = 0;
+        break;
 
-      _currentSegmentNr = 0;
-    }
-    else if (_path == "/gpx/trk/trkseg")
-    {
-      _currentSegmentNr++;
+      case GpxPath::TRK:
+        if (!_trackName.empty() && _segmentNr == 0) _inTrack = true;
 
-      if (_segmentNr != 0 && _segmentNr == _currentSegmentNr)
-      {
         _currentText.clear();
+        _currentName.clear();
 
-        _inSegment = true;
-      }
+        _currentSegmentNr = 0;
+        break;
+
+      case GpxPath::TRKSEG:
+        _currentSegmentNr++;
+
+        if (_segmentNr != 0 && _segmentNr == _currentSegmentNr)
+        {
+          _currentText.clear();
+
+          _inSegment = true;
+        }
+        break;
+
+      default:
+        break;
     }
   }
 
   void doEndElement()
   {
-    if (_path == "/gpx/wpt")
+    switch (_path.state())
     {
-      if (_inWaypoint && _currentName != _waypointName) *_outputFile << _currentText;
+      case GpxPath::WPT:
+        if (_inWaypoint && _currentName != _waypointName) _output->write(_currentText);
 
-      _inWaypoint = false;
-    }
-    else if (_path == "/gpx/rte")
-    {
-      if (_inRoute && _currentName != _routeName) *_outputFile << _currentText;
+        _inWaypoint = false;
+        break;
 
-      _inRoute = false;
-    }
-    else if (_path == "/gpx/trk")
-    {
-      if (_inTrack && _currentName != _trackName) *_outputFile << _currentText;
+      case GpxPath::RTE:
+        if (_inRoute && _currentName != _routeName) _output->write(_currentText);
 
-      _inTrack = false;
-    }
-    else if (_path == "/gpx/trk/trkseg")
-    {
-      if (_inSegment && _currentName != _trackName) *_outputFile << _currentText;
+        _inRoute = false;
+        break;
 
-      _inSegment = false;
-    }
+      case GpxPath::TRK:
+        if (_inTrack && _currentName != _trackName) _output->write(_currentText);
+
+        _inTrack = false;
+        break;
 
-    size_t i =  _path.find_last_of('/');
+      case GpxPath::TRKSEG:
+        if (_inSegment && _currentName != _trackName) _output->write(_currentText);
 
-    if (i != std::string::npos) _path.erase(i);
+        _inSegment = false;
+        break;
+
+      default:
+        break;
+    }
+
+    _path.pop();
   }
 
 public:
   // -- Callbacks -------------------------------------------------------------
-  virtual void xmlDecl(const std::string &text, const Attributes &)
+  virtual void xmlDecl(std::string_view text, const Attributes &)
   {
     log(text);
   }
 
-  virtual void processingInstruction(const std::string &text, const std::string &, const std::string &)
+  virtual void processingInstruction(std::string_view text, std::string_view, std::string_view)
   {
     log(text);
   }
 
-  virtual void docTypeDecl(const std::string &text)
+  virtual void docTypeDecl(std::string_view text)
   {
     log(text);
   }
 
-  virtual void unhandled(const std::string &text, int lineNumber, int columnNumber)
+  virtual void unhandled(std::string_view text, int lineNumber, int columnNumber)
   {
+    _output->close();
+
     std::cerr << "  ERROR: Unexpected gpx info: " << text <<  " on line: " << lineNumber << " columnNumber: " << columnNumber << std::endl;
     exit(1);
   }
 
-  virtual void cdataDecl(const std::string &text, const std::string &)
+  virtual void cdataDecl(std::string_view text, std::string_view)
   {
     log(text);
   }
 
-  virtual void comment(const std::string &text, const std::string &)
+  virtual void comment(std::string_view text, std::string_view)
   {
     log(text);
   }
 
-  virtual void startEndElement(const std::string &text, const std::string &name, const Attributes &)
+  virtual void startEndElement(std::string_view text, std::string_view name, const Attributes &)
   {
     doStartElement(name);
 
@@ -185,46 +207,54 @@ public:
     doEndElement();
   }
 
-  virtual void startElement(const std::string &text, const std::string &name, const Attributes &)
+  virtual void startElement(std::string_view text, std::string_view name, const Attributes &)
   {
     doStartElement(name);
 
     log(text);
   }
 
-  virtual void text(const std::string &text)
+  virtual void text(std::string_view text)
   {
-    if (_path == "/gpx/wpt/name" || _path == "/gpx/rte/name" || _path == "/gpx/trk/name")
+    GpxPath::State state = _path.state();
+
+    if (state == GpxPath::WPT_NAME || state == GpxPath::RTE_NAME || state == GpxPath::TRK_NAME)
     {
-      _currentName = XMLParser::translateEntityRefs(XMLParser::trim(text));
+      _currentName = XMLParser::decodeEntityRefs(XMLParser::trim(text), _buffer);
     }
 
     log(text);
   }
 
-  virtual void endElement(const std::string &text, const std::string &)
+  virtual void endElement(std::string_view text, std::string_view)
   {
     log(text);
 
     doEndElement();
   }
 
+  virtual void skipped(std::string_view text)
+  {
+    log(text);
+  }
+
 
 private:
   // Members
-  std::ostream *_outputFile;
+  XMLOutput    *_output;
   std::string   _waypointName;
   std::string   _trackName;
   int           _segmentNr; // 1..
   std::string   _routeName;
 
-  std::string   _path;
+  GpxPath       _path;
 
   bool          _inWaypoint;
   bool          _inRoute;
   bool          _inTrack;
-  std::string   _currentText;
+  XMLOutputPart _currentText;
   std::string   _currentName;
+  std::string   _buffer;
 
   bool          _inSegment;
   int           _currentSegmentNr;
@@ -251,6 +281,7 @@ int main(int argc, char *argv[])
       std::cout << "  -s <segment>    remove only segment in track (1..)" << std::endl;
       std::cout << "  -r \"<name>\"     remove the route with <name>" << std::endl;
       std::cout << "  -o <out.gpx>    the output gpx file (overwrites existing file)" << std::endl;
+      std::cout << "                  a .gz file is written gzip compressed" << std::endl;
       std::cout << " file.gpx         the input gpx file" << std::endl << std::endl;
       std::cout << "   Remove a waypoint, track or route from a gpx file" << std::endl;
       return 0;
@@ -298,25 +329,27 @@ int main(int argc, char *argv[])
     }
     else if (argv[i][0] != '-')
     {
-      std::ifstream stream(argv[i]);
+      XMLInput input;
 
-      if (!stream.is_open())
+      if (!input.open(argv[i]))
       {
         std::cerr << "Error: unable to open: " << argv[i] << std::endl;
         return 1;
       }
 
+      XMLOutput output;
+
       if (outputFilename.empty())
       {
-        gpxrm.parseFile(stream, std::cout);
+        output.open(STDOUT_FILENO);
+
+        gpxrm.parseFile(input, output);
       }
       else
       {
-        std::ofstream output(outputFilename.c_str());
-
-        if (output.is_open())
+        if (output.open(outputFilename))
         {
-          gpxrm.parseFile(stream, output);
+          gpxrm.parseFile(input, output);
 
           output.close();
         }
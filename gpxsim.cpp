@@ -1,23 +1,27 @@
 #include <iostream>
 #include <cstring>
-#include <fstream>
+#include <unistd.h>
 #include <list>
 #include <cmath>
 #include <limits>
 #include <iomanip>
 
 #include "XMLParser.h"
+#include "XMLInput.h"
+#include "XMLOutput.h"
+#include "XMLNumber.h"
+#include "GpxPath.h"
 
 const std::string version= "0.1.0";
 
 // ----------------------------------------------------------------------------
 
-class GpxSim : public XMLParserHandler
+class GpxSim : public XMLParserViewHandler
 {
 public:
   // -- Constructor -----------------------------------------------------------
   GpxSim() :
-    _outputFile(&std::cout),
+    _output(nullptr),
     _verbose(false),
     _simplifyDistance(0.0),
     _simplifyCrossTrack(0.0),
@@ -42,16 +46,28 @@ public:
   void setSimplifyToNumber(int number) { _simplifyToNumber = number; }
 
   // -- Parse a file ----------------------------------------------------------
-  bool parseFile(std::istream &input, std::ostream &output)
+  bool parseFile(XMLInput &input, XMLOutput &output)
   {
     _path.clear();
 
-    _outputFile = &output;
+    // The unchanged text is copied from the input
+    _output = &output;
+
+    _output->setInput(&input);
+
+    // The extensions are not used, but copied
+    XMLParserFilter filter;
+
+    filter.setSkipFor({ "extensions" });
 
     XMLParser parser(this);
 
+    parser.setFilter(filter);
+
     parser.parse(input);
 
+    _output->setInput(nullptr);
+
     return true;
   }
 
@@ -119,28 +135,18 @@ public:
   // std::cout << "Crosstrack:" << GpxSim::calcCrosstrack(53.3206, -1.7297, 53.1887, 0.1334, 53.2611, -0.7972) << std::endl; // -307.55
 
 
-  static double getDouble(const std::string &value)
+  static double getDouble(std::string_view value)
   {
-    try
-    {
-      return std::stod(value);
-    }
-    catch (...)
-    {
-      return std::numeric_limits<double>::min();
-    }
+    double result;
+
+    return XMLNumber::toDouble(value, result) ? result : std::numeric_limits<double>::min();
   }
 
   static double getInt(const std::string &value)
   {
-    try
-    {
-      return std::stoi(value);
-    }
-    catch (...)
-    {
-      return 0;
-    }
+    int result;
+
+    return XMLNumber::toInt(value, result) ? result : 0;
   }
 
 private:
@@ -167,21 +173,21 @@ private:
     }
 
     ChunkType     _type;
-    std::string   _text;
+    XMLOutputPart _text;
     double        _lat;
     double        _lon;
     double        _crossTrack;
   };
 
-  void store(const std::string &text)
+  void store(std::string_view text)
   {
     if (_inPoints)
     {
-      _current._text.append(text);
+      _output->append(_current._text, text);
     }
     else
     {
-      *_outputFile << text;
+      _output->write(text);
     }
   }
 
@@ -193,7 +199,7 @@ private:
     {
       if (last != ChunkType::TEXT || _chunks.front()._type != ChunkType::TEXT)
       {
-        *_outputFile << _chunks.front()._text;
+        _output->write(_chunks.front()._text);
       }
 
       last = _chunks.front()._type;
@@ -393,102 +399,115 @@ private:
     }
   }
 
-  static double getDoubleAttribute(const Attributes &atts, const std::string &key)
+  static double getDoubleAttribute(const Attributes &atts, std::string_view key)
   {
-    auto iter = atts.find(key);
+    double value;
 
-    return iter != atts.end() ? getDouble(iter->second) : std::numeric_limits<double>::min();
+    return atts.getDouble(key, value) ? value : std::numeric_limits<double>::min();
   }
 
 
-  void doStartElement(const std::string &name, const Attributes &attributes)
+  void doStartElement(std::string_view name, const Attributes &attributes)
   {
-    _path.append("/");
-    _path.append(name);
-
-    if (_path == "/gpx/trk/trkseg" || _path == "/gpx/rte")
+    switch (_path.push(name))
     {
-      _current.clear();
+      case GpxPath::TRKSEG:
+      case GpxPath::RTE:
+        _current.clear();
 
-      _inPoints = true;
-    }
-    else if (_path == "/gpx/trk/trkseg/trkpt" || _path == "/gpx/rte/rtept")
-    {
-      if (!_current._text.empty()) _chunks.push_back(_current);
+        _inPoints = true;
+        break;
+
+      case GpxPath::TRKPT:
+      case GpxPath::RTEPT:
+      {
+        if (!_current._text.empty()) _chunks.push_back(_current);
 
-      _current.clear();
+        _current.clear();
 
-      double lat = getDoubleAttribute(attributes, "lat");
-      double lon = getDoubleAttribute(attributes, "lon");
+        double lat = getDoubleAttribute(attributes, "lat");
+        double lon = getDoubleAttribute(attributes, "lon");
+
+        _current.point(lat, lon);
+        break;
+      }
 
-      _current.point(lat, lon);
+      default:
+        break;
     }
   }
 
   void doEndElement()
   {
-    if (_path == "/gpx/trk/trkseg" || _path == "/gpx/rte")
+    switch (_path.state())
     {
-      if (!_current._text.empty()) _chunks.push_back(_current);
+      case GpxPath::TRKSEG:
+      case GpxPath::RTE:
+        if (!_current._text.empty()) _chunks.push_back(_current);
 
-      if (_verbose) verboseChunks("Original  segment:");
+        if (_verbose) verboseChunks("Original  segment:");
 
-      if (_simplifyDistance > 0.0)   simplifyDistance();
-      if (_simplifyCrossTrack > 0.0) simplifyCrossTrack();
-      if (_simplifyToNumber > 0)     simplifyToNumber();
+        if (_simplifyDistance > 0.0)   simplifyDistance();
+        if (_simplifyCrossTrack > 0.0) simplifyCrossTrack();
+        if (_simplifyToNumber > 0)     simplifyToNumber();
 
-      if (_verbose) verboseChunks("Optimized segment:");
+        if (_verbose) verboseChunks("Optimized segment:");
 
-      outputChunks();
+        outputChunks();
 
-      _inPoints = false;
-    }
-    else if (_path == "/gpx/trk/trkseg/trkpt" || _path == "/gpx/rte/rtept")
-    {
-      _chunks.push_back(_current);
+        _inPoints = false;
+        break;
 
-      _current.clear();
-    }
+      case GpxPath::TRKPT:
+      case GpxPath::RTEPT:
+        _chunks.push_back(_current);
+
+        _current.clear();
+        break;
 
-    size_t i =  _path.find_last_of('/');
+      default:
+        break;
+    }
 
-    if (i != std::string::npos) _path.erase(i);
+    _path.pop();
   }
 
 public:
   // -- Callbacks -------------------------------------------------------------
-  virtual void xmlDecl(const std::string &text, const Attributes &)
+  virtual void xmlDecl(std::string_view text, const Attributes &)
   {
     store(text);
   }
 
-  virtual void processingInstruction(const std::string &text, const std::string &, const std::string &)
+  virtual void processingInstruction(std::string_view text, std::string_view, std::string_view)
   {
     store(text);
   }
 
-  virtual void docTypeDecl(const std::string &text)
+  virtual void docTypeDecl(std::string_view text)
   {
     store(text);
   }
 
-  virtual void unhandled(const std::string &text, int lineNumber, int columnNumber)
+  virtual void unhandled(std::string_view text, int lineNumber, int columnNumber)
   {
+    _output->close();
+
     std::cerr << "  ERROR: Unexpected gpx info: " << text <<  " on line: " << lineNumber << " columnNumber: " << columnNumber << std::endl;
     exit(1);
   }
 
-  virtual void cdataDecl(const std::string &text, const std::string &)
+  virtual void cdataDecl(std::string_view text, std::string_view)
   {
     store(text);
   }
 
-  virtual void comment(const std::string &text, const std::string &)
+  virtual void comment(std::string_view text, std::string_view)
   {
     store(text);
   }
 
-  virtual void startEndElement(const std::string &text, const std::string &name, const Attributes &attributes)
+  virtual void startEndElement(std::string_view text, std::string_view name, const Attributes &attributes)
   {
     doStartElement(name, attributes);
 
@@ -497,35 +516,40 @@ public:
     doEndElement();
   }
 
-  virtual void startElement(const std::string &text, const std::string &name, const Attributes &attributes)
+  virtual void startElement(std::string_view text, std::string_view name, const Attributes &attributes)
   {
     doStartElement(name, attributes);
 
     store(text);
   }
 
-  virtual void text(const std::string &text)
+  virtual void text(std::string_view text)
   {
     store(text);
   }
 
-  virtual void endElement(const std::string &text, const std::string &)
+  virtual void endElement(std::string_view text, std::string_view)
   {
     store(text);
 
     doEndElement();
   }
 
+  virtual void skipped(std::string_view text)
+  {
+    store(text);
+  }
+
 private:
 
   // Members
-  std::ostream     *_outputFile;
+  XMLOutput        *_output;
   bool              _verbose;
   double            _simplifyDistance;
   double            _simplifyCrossTrack;
   int               _simplifyToNumber;
 
-  std::string       _path;
+  GpxPath           _path;
 
   bool              _inPoints;
   Chunk             _current;
@@ -553,6 +577,7 @@ int main(int argc, char *argv[])
       std::cout << "  -n <number>     remove route or track points until the route or track contains <number> points (2..)" << std::endl;
       std::cout << "  -x <distance>   remove route or track points with a cross track distance less than <distance> (in m)" << std::endl;
       std::cout << "  -o <out.gpx>    the output gpx file (overwrites existing file)" << std::endl;
+      std::cout << "                  a .gz file is written gzip compressed" << std::endl;
       std::cout << " file.gpx         the input gpx file" << std::endl << std::endl;
       std::cout << "   Simplify a route or track using the distance threshold and/or the Douglas-Peucker algorithm." << std::endl;
       return 0;
@@ -621,27 +646,29 @@ int main(int argc, char *argv[])
     }
     else if (argv[i][0] != '-')
     {
-      std::ifstream stream(argv[i]);
+      XMLInput input;
 
-      if (!stream.is_open())
+      if (!input.open(argv[i]))
       {
         std::cerr << "Error: unable to open: " << argv[i] << std::endl;
         return 1;
       }
 
+      XMLOutput output;
+
       if (outputFilename.empty())
       {
         gpxSim.setVerbose(false);
 
-        gpxSim.parseFile(stream, std::cout);
+        output.open(STDOUT_FILENO);
+
+        gpxSim.parseFile(input, output);
       }
       else
       {
-        std::ofstream output(outputFilename.c_str());
-
-        if (output.is_open())
+        if (output.open(outputFilename))
         {
-          gpxSim.parseFile(stream, output);
+          gpxSim.parseFile(input, output);
 
           output.close();
         }
@@ -1,6 +1,6 @@
 #include <iostream>
 #include <cstring>
-#include <fstream>
+#include <unistd.h>
 #include <list>
 #include <cmath>
 #include <ctime>
@@ -9,18 +9,22 @@
 #include <stdexcept>
 
 #include "XMLParser.h"
+#include "XMLInput.h"
+#include "XMLOutput.h"
+#include "XMLNumber.h"
+#include "GpxPath.h"
 
 const std::string tool    = "gpxsplit";
 const std::string version = "0.1.0";
 
 // ----------------------------------------------------------------------------
 
-class GpxSplit : public XMLParserHandler
+class GpxSplit : public XMLParserViewHandler
 {
 public:
   // -- Constructor -----------------------------------------------------------
   GpxSplit() :
-    _outputFile(&std::cout),
+    _output(nullptr),
     _TrkNr(0),
     _TrkSegNr(0),
     _inTrkSeg(false),
@@ -50,11 +54,14 @@ public:
   void setDuration(int seconds) { _duration = seconds; }
 
   // -- Parse a file ----------------------------------------------------------
-  bool parseFile(std::istream &input, std::ostream &output)
+  bool parseFile(XMLInput &input, XMLOutput &output)
   {
     _path.clear();
 
-    _outputFile = &output;
+    // The unchanged text is copied from the input
+    _output = &output;
+
+    _output->setInput(&input);
 
     _TrkNr = 0;
     _TrkSegNr = 0;
@@ -63,31 +70,23 @@ public:
 
     parser.parse(input);
 
+    _output->setInput(nullptr);
+
     return true;
   }
 
-  static double getDouble(const std::string &value)
+  static double getDouble(std::string_view value)
   {
-    try
-    {
-      return std::stod(value);
-    }
-    catch (...)
-    {
-      return std::numeric_limits<double>::min();
-    }
+    double result;
+
+    return XMLNumber::toDouble(value, result) ? result : std::numeric_limits<double>::min();
   }
 
   static double getInt(const std::string &value)
   {
-    try
-    {
-      return std::stoi(value);
-    }
-    catch (...)
-    {
-      return 0;
-    }
+    int result;
+
+    return XMLNumber::toInt(value, result) ? result : 0;
   }
 
 private:
@@ -113,7 +112,7 @@ private:
     }
 
     ChunkType     _type;
-    std::string   _text;
+    XMLOutputPart _text;
     double        _lat;
     double        _lon;
     double        _distance;
@@ -122,34 +121,20 @@ private:
   };
 
   // -- Methods ---------------------------------------------------------------
-  static bool getDoubleAttribute(const Attributes &atts, const std::string &key, double &value)
+  static bool getDoubleAttribute(const Attributes &atts, std::string_view key, double &value)
   {
-    auto iter = atts.find(key);
-
-    if (iter == atts.end()) return false;
-
-    if (iter->second.empty()) return false;
-    try
-    {
-      value = std::stod(iter->second);
-
-      return true;
-    }
-    catch(...)
-    {
-      return false;
-    }
+    return atts.getDouble(key, value);
   }
 
-  void store(const std::string &text)
+  void store(std::string_view text)
   {
     if (_inTrkSeg)
     {
-      _current._text.append(text);
+      _output->append(_current._text, text);
     }
     else if (!_analyse)
     {
-      *_outputFile << text;
+      _output->write(text);
     }
   }
 
@@ -159,7 +144,7 @@ private:
 
     if (timeStr.size() == 0) return;
 
-    struct tm tm;
+    struct tm tm = {};
 
     if (strptime(timeStr.c_str(), "%Y-%m-%dT%TZ", &tm) == nullptr) return;
 
@@ -239,127 +224,134 @@ private:
           }
           else
           {
-            *_outputFile << _endTrkSeg;
-            *_outputFile << _startTrkSeg;
+            _output->write(_endTrkSeg);
+            _output->write(_startTrkSeg);
           }
         }
 
         previous = *iter;
       }
 
-      if (!_analyse) *_outputFile << iter->_text;
+      if (!_analyse) _output->write(iter->_text);
     }
   }
 
-  void doStartElement(const std::string &text, const std::string &name, const Attributes &attributes)
+  void doStartElement(std::string_view text, std::string_view name, const Attributes &attributes)
   {
-    _path.append("/");
-    _path.append(name);
-
-    if (_path == "/gpx/trk")
-    {
-      _TrkNr++;
-      _TrkSegNr = 0;
-    }
-    else if (_path == "/gpx/trk/trkseg")
+    switch (_path.push(name))
     {
-      _startTrkSeg = text;
+      case GpxPath::TRK:
+        _TrkNr++;
+        _TrkSegNr = 0;
+        break;
 
-      _chunks.clear();
-      _current.clear(TEXT);
-      _previous.clear(TEXT);
+      case GpxPath::TRKSEG:
+        _startTrkSeg = text;
 
-      _inTrkSeg = true;
-      _TrkSegNr++;
-    }
-    else if (_path == "/gpx/trk/trkseg/trkpt")
-    {
-      if (!_current._text.empty()) _chunks.push_back(_current);
+        _chunks.clear();
+        _current.clear(TEXT);
+        _previous.clear(TEXT);
 
-      _current.clear(TEXT);
+        _inTrkSeg = true;
+        _TrkSegNr++;
+        break;
 
-      if (getDoubleAttribute(attributes, "lat", _current._lat) &&
-          getDoubleAttribute(attributes, "lon", _current._lon))
-      {
-        _current._type = POINT;
+      case GpxPath::TRKPT:
+        if (!_current._text.empty()) _chunks.push_back(_current);
+
+        _current.clear(TEXT);
 
-        if (_previous._type == POINT)
+        if (getDoubleAttribute(attributes, "lat", _current._lat) &&
+            getDoubleAttribute(attributes, "lon", _current._lon))
         {
-          _current._distance = calcDistance(_previous._lat, _previous._lon, _current._lat, _current._lon);
+          _current._type = POINT;
+
+          if (_previous._type == POINT)
+          {
+            _current._distance = calcDistance(_previous._lat, _previous._lon, _current._lat, _current._lon);
+          }
         }
-      }
-    }
-    else if (_path == "/gpx/trk/trkseg/trkpt/time")
-    {
-      // <time>2012-12-03T13:13:38Z</time>
-      _inTime = true;
-      _current._timeStr.clear();
+        break;
+
+      case GpxPath::TRKPT_TIME:
+        // <time>2012-12-03T13:13:38Z</time>
+        _inTime = true;
+        _current._timeStr.clear();
+        break;
+
+      default:
+        break;
     }
   }
 
-  void doEndElement(const std::string &text)
+  void doEndElement(std::string_view text)
   {
-    if (_path == "/gpx/trk/trkseg")
+    switch (_path.state())
     {
-      _endTrkSeg = text;
+      case GpxPath::TRKSEG:
+        _endTrkSeg = text;
 
-      if (!_current._text.empty()) _chunks.push_back(_current);
+        if (!_current._text.empty()) _chunks.push_back(_current);
 
-      analyseChunks();
+        analyseChunks();
 
-      _inTrkSeg = false;
-    }
-    else if (_path == "/gpx/trk/trkseg/trkpt")
-    {
-      _chunks.push_back(_current);
-      if (_current._type == POINT) _previous = _current;
-      _current.clear(TEXT);
-    }
-    else if (_path == "/gpx/trk/trkseg/trkpt/time")
-    {
-      _inTime = false;
-      processTimeStr(_current._timeStr, _current._time);
-    }
+        _inTrkSeg = false;
+        break;
+
+      case GpxPath::TRKPT:
+        _chunks.push_back(_current);
+        if (_current._type == POINT) _previous = _current;
+        _current.clear(TEXT);
+        break;
 
-    size_t i =  _path.find_last_of('/');
+      case GpxPath::TRKPT_TIME:
+        _inTime = false;
+        processTimeStr(_current._timeStr, _current._time);
+        break;
 
-    if (i != std::string::npos) _path.erase(i);
+      default:
+        break;
+    }
+
+    _path.pop();
   }
 
 public:
   // -- Callbacks -------------------------------------------------------------
-  virtual void xmlDecl(const std::string &text, const Attributes &)
+  virtual void xmlDecl(std::string_view text, const Attributes &)
   {
     store(text);
   }
 
-  virtual void processingInstruction(const std::string &text, const std::string &, const std::string &)
+  virtual void processingInstruction(std::string_view text, std::string_view, std::string_view)
   {
     store(text);
   }
 
-  virtual void docTypeDecl(const std::string &text)
+  virtual void docTypeDecl(std::string_view text)
   {
     store(text);
   }
 
-  virtual void unhandled(const std::string &text, int lineNumber, int columnNumber)
+  virtual void unhandled(std::string_view text, int lineNumber, int columnNumber)
   {
+    _output->close();
+
     std::cerr << "  ERROR: Unexpected gpx info: " << text <<  " on line: " << lineNumber << " columnNumber: " << columnNumber << std::endl;
     exit(1);
   }
 
-  virtual void cdataDecl(const std::string &text, const std::string &)
+  virtual void cdataDecl(std::string_view text, std::string_view)
   {
     store(text);
   }
 
-  virtual void comment(const std::string &text, const std::string &)
+  virtual void comment(std::string_view text, std::string_view)
   {
     store(text);
   }
 
-  virtual void startEndElement(const std::string &text, const std::string &name, const Attributes &attributes)
+  virtual void startEndElement(std::string_view text, std::string_view name, const Attributes &attributes)
   {
     doStartElement(text, name, attributes);
 
@@ -368,14 +360,14 @@ public:
     doEndElement(text);
   }
 
-  virtual void startElement(const std::string &text, const std::string &name, const Attributes &attributes)
+  virtual void startElement(std::string_view text, std::string_view name, const Attributes &attributes)
   {
     doStartElement(text, name, attributes);
 
     store(text);
   }
 
-  virtual void text(const std::string &text)
+  virtual void text(std::string_view text)
   {
     if (_inTime)
     {
@@ -384,7 +376,7 @@ public:
     store(text);
   }
 
-  virtual void endElement(const std::string &text, const std::string &)
+  virtual void endElement(std::string_view text, std::string_view)
   {
     store(text);
 
@@ -393,9 +385,9 @@ public:
 
 private:
   // -- Members ---------------------------------------------------------------
-  std::string         _path;
+  GpxPath             _path;
 
-  std::ostream       *_outputFile;
+  XMLOutput          *_output;
 
   int                 _TrkNr;
   int                 _TrkSegNr;
@@ -437,6 +429,7 @@ int main(int argc, char *argv[])
       std::cout << "  -m <duration>        split based on time duration, in minutes" << std::endl;
       std::cout << "  -u <duration>        split based on time duration, in hours" << std::endl;
       std::cout << "  -o <out.gpx>         the output gpx file (overwrites existing file)" << std::endl;
+      std::cout << "                       a .gz file is written gzip compressed" << std::endl;
       std::cout << " file.gpx              the input gpx file" << std::endl << std::endl;
       std::cout << "   Split the track segments in a gpx in multiple track segments based on distance or time." << std::endl;
       return 0;
@@ -473,7 +466,7 @@ int main(int argc, char *argv[])
     }
     else if (strcmp(argv[i], "-t") == 0 && i+1 < argc)
     {
-      struct tm fields;
+      struct tm fields = {};
 
       if (strptime(argv[++i], "%Y-%m-%d %H:%M:%S", &fields) != nullptr)
       {
@@ -562,35 +555,39 @@ int main(int argc, char *argv[])
   }
 
 
-  std::ifstream input;
+  XMLInput input;
 
   if (!inputFilename.empty())
   {
-    input.open(inputFilename.c_str());
-
-    if (!input.is_open())
+    if (!input.open(inputFilename))
     {
       std::cerr << "Error: unable to open the inputfile: " << inputFilename << std::endl;
       return 1;
     }
   }
+  else
+  {
+    input.open(STDIN_FILENO);
+  }
 
-  std::ofstream output;
+  XMLOutput output;
 
   if (!outputFilename.empty())
   {
-    output.open(outputFilename.c_str());
-
-    if (!output.is_open())
+    if (!output.open(outputFilename))
     {
       std::cerr << "Error: unable to open the outputfile: " << outputFilename << std::endl;
     }
   }
+  else
+  {
+    output.open(STDOUT_FILENO);
+  }
 
-  gpxSplit.parseFile((inputFilename.empty() ? std::cin : input), (outputFilename.empty() ? std::cout : output));
+  gpxSplit.parseFile(input, output);
 
-  if (!inputFilename .empty()) input.close();
-  if (!outputFilename.empty()) output.close();
+  input.close();
+  output.close();
   
   return 0;
 }